@@ -120,3 +120,15 @@ EXPLAIN (costs off)
 SELECT * FROM test_table WHERE tsv @@ (to_tsquery('wordA')) AND (folder = 10::bigint) ORDER BY time <=| 500::bigint;
 SELECT * FROM test_table WHERE tsv @@ (to_tsquery('wordA')) AND (folder = 10::bigint) ORDER BY time <=| 500::bigint;
 
+-- Tids of the keys ordered by tid are collected into sorted arrays, which
+-- turn into bitmaps once they exceed work_mem, on the first key or a later one
+CREATE TABLE test_table_tids (id int, a bigint, b bigint, c bigint, time bigint, tsv tsvector);
+CREATE INDEX test_tids_idx ON test_table_tids USING rum(a, b, c, tsv rum_tsvector_addon_ops, time) with (attach = 'time', to = 'tsv', order_by_attach=TRUE);
+INSERT INTO test_table_tids
+	SELECT i, i % 100, i % 2, i % 3, i, to_tsvector('wordA')
+	FROM generate_series(1, 20000) i;
+SET work_mem = '64kB';
+SELECT count(*) FROM test_table_tids WHERE tsv @@ (to_tsquery('wordA')) AND a = 4::bigint AND b = 0::bigint;
+SELECT count(*) FROM test_table_tids WHERE tsv @@ (to_tsquery('wordA')) AND b = 0::bigint AND c = 1::bigint;
+SELECT count(*) FROM test_table_tids WHERE tsv @@ (to_tsquery('wordA')) AND a = 4::bigint AND b = 0::bigint AND c = 1::bigint;
+RESET work_mem;
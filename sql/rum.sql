@@ -142,6 +142,246 @@ SELECT (a <=> to_tsquery('pg_catalog.english', 'b:*'))::numeric(10,4) AS distanc
 	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
 	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*');
 
+-- Check bounded ordered scan
+SET rum.sort_limit = 5;
+SELECT (a <=> to_tsquery('pg_catalog.english', 'b:*'))::numeric(10,4) AS distance
+	FROM test_rum
+	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
+	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*') LIMIT 3;
+SELECT (a <=> to_tsquery('pg_catalog.english', 'b:*'))::numeric(10,4) AS distance
+	FROM test_rum
+	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
+	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*') LIMIT 8;
+SELECT count(*), count(DISTINCT ctid) FROM
+	(SELECT ctid FROM test_rum
+	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
+	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*')) t;
+RESET rum.sort_limit;
+
+-- Check heap prefetch look-ahead
+SET rum.heap_prefetch_distance = 2;
+SET rum.sort_limit = 5;
+SELECT (a <=> to_tsquery('pg_catalog.english', 'b:*'))::numeric(10,4) AS distance
+	FROM test_rum
+	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
+	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*') LIMIT 8;
+SELECT count(*), count(DISTINCT ctid) FROM
+	(SELECT ctid FROM test_rum
+	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
+	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*')) t;
+RESET rum.sort_limit;
+SELECT count(*), count(DISTINCT ctid) FROM
+	(SELECT ctid FROM test_rum
+	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
+	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*')) t;
+RESET rum.heap_prefetch_distance;
+
+-- Check parallel index scan
+SET max_parallel_workers_per_gather = 2;
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET min_parallel_index_scan_size = 0;
+SELECT count(*) FROM test_rum WHERE a @@ to_tsquery('pg_catalog.english', 'ever|wrote');
+SELECT (a <=> to_tsquery('pg_catalog.english', 'b:*'))::numeric(10,4) AS distance
+	FROM test_rum
+	WHERE a @@ to_tsquery('pg_catalog.english', 'b:*')
+	ORDER BY a <=> to_tsquery('pg_catalog.english', 'b:*') LIMIT 8;
+RESET max_parallel_workers_per_gather;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET min_parallel_index_scan_size;
+
+-- Check that parallel index scan is chosen and its chunks are claimed by
+-- the participants
+CREATE TABLE test_rum_parallel AS
+	SELECT to_tsvector('simple', 'w' || (i % 10) || ' x' || (i % 7)) AS a
+	FROM generate_series(1, 5000) i;
+CREATE INDEX test_rum_parallel_idx ON test_rum_parallel USING rum (a rum_tsvector_ops);
+ALTER TABLE test_rum_parallel SET (parallel_workers = 2);
+SET max_parallel_workers_per_gather = 2;
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET min_parallel_index_scan_size = 0;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SET rum.parallel_chunk_size = 1;
+EXPLAIN (costs off)
+SELECT count(*) FROM test_rum_parallel WHERE a @@ to_tsquery('simple', 'w1 | x3');
+SELECT count(*) FROM test_rum_parallel WHERE a @@ to_tsquery('simple', 'w1 | x3');
+SELECT count(*) FROM test_rum_parallel WHERE a @@ to_tsquery('simple', 'w1 & x3');
+RESET rum.parallel_chunk_size;
+SELECT count(*) FROM test_rum_parallel WHERE a @@ to_tsquery('simple', 'w1 & x3');
+RESET max_parallel_workers_per_gather;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET min_parallel_index_scan_size;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+-- Check fillfactor of posting tree leaves
+CREATE TABLE test_rum_fillfactor AS
+	SELECT i AS id, to_tsvector('simple', 'hot x' || (i % 3)) AS a
+	FROM generate_series(1, 20000) i;
+CREATE INDEX test_rum_fillfactor_full ON test_rum_fillfactor
+	USING rum (a rum_tsvector_ops) WITH (fillfactor = 100);
+CREATE INDEX test_rum_fillfactor_half ON test_rum_fillfactor
+	USING rum (a rum_tsvector_ops) WITH (fillfactor = 50);
+SELECT pg_relation_size('test_rum_fillfactor_half') >
+	   1.5 * pg_relation_size('test_rum_fillfactor_full') AS larger;
+CREATE INDEX ON test_rum_fillfactor USING rum (a rum_tsvector_ops) WITH (fillfactor = 5);
+DROP INDEX test_rum_fillfactor_full;
+INSERT INTO test_rum_fillfactor
+	SELECT i, to_tsvector('simple', 'hot x1') FROM generate_series(20001, 20100) i;
+SET enable_seqscan = off;
+SELECT count(*) FROM test_rum_fillfactor WHERE a @@ to_tsquery('simple', 'hot');
+SELECT count(*) FROM test_rum_fillfactor WHERE a @@ to_tsquery('simple', 'x1');
+RESET enable_seqscan;
+DROP TABLE test_rum_fillfactor;
+
+-- Check cost estimate of ordered scans
+CREATE TABLE test_rum_order AS
+	SELECT i AS id, to_tsvector('simple', 'w' || (i % 10)) AS t,
+		   '2016-05-01'::timestamp + i * interval '1 minute' AS d
+	FROM generate_series(1, 10000) i;
+CREATE INDEX test_rum_order_idx ON test_rum_order
+	USING rum (t rum_tsvector_addon_ops, d)
+	WITH (attach = 'd', to = 't', order_by_attach = 't');
+ANALYZE test_rum_order;
+CREATE FUNCTION rum_index_scan_costs(query text,
+									 OUT startup float8, OUT total float8) AS $$
+DECLARE
+	node json;
+BEGIN
+	EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO node;
+	node := node->0->'Plan';
+	WHILE node->>'Node Type' <> 'Index Scan' LOOP
+		node := node->'Plans'->0;
+	END LOOP;
+	startup := (node->>'Startup Cost')::float8;
+	total := (node->>'Total Cost')::float8;
+END;
+$$ LANGUAGE plpgsql;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SET enable_sort = off;
+-- Natural order: items are returned as the posting tree is read
+EXPLAIN (costs off)
+SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=| '2016-05-03';
+SELECT startup < total AS streamed FROM rum_index_scan_costs($$
+	SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=| '2016-05-03'$$);
+-- <=> has no direction, items are collected and sorted
+EXPLAIN (costs off)
+SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=> '2016-05-03';
+SELECT startup = total AS sorted FROM rum_index_scan_costs($$
+	SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=> '2016-05-03'$$);
+-- Without a condition on t, items are collected and sorted as well
+EXPLAIN (costs off)
+SELECT id FROM test_rum_order WHERE d < '2016-05-02' ORDER BY d <=| '2016-05-03';
+SELECT startup = total AS sorted FROM rum_index_scan_costs($$
+	SELECT id FROM test_rum_order WHERE d < '2016-05-02' ORDER BY d <=| '2016-05-03'$$);
+-- A LIMIT within rum.sort_limit is sorted in a bounded heap
+SET rum.sort_limit = 10;
+EXPLAIN (costs off)
+SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=> '2016-05-03' LIMIT 5;
+SELECT bounded.total < unbounded.total AS cheaper
+FROM rum_index_scan_costs($$
+	SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=> '2016-05-03' LIMIT 5$$) bounded,
+	 rum_index_scan_costs($$
+	SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=> '2016-05-03' LIMIT 50$$) unbounded;
+RESET rum.sort_limit;
+SELECT bounded.total = unbounded.total AS same
+FROM rum_index_scan_costs($$
+	SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=> '2016-05-03' LIMIT 5$$) bounded,
+	 rum_index_scan_costs($$
+	SELECT id FROM test_rum_order WHERE t @@ 'w1' ORDER BY d <=> '2016-05-03' LIMIT 50$$) unbounded;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_sort;
+DROP FUNCTION rum_index_scan_costs(text);
+DROP TABLE test_rum_order;
+
+-- Appends to the rightmost leaf of a multi-level posting tree, mixed with
+-- vacuum which deletes leaves and rewrites the rightmost one
+CREATE TABLE test_rum_hot (id int, t tsvector);
+CREATE INDEX test_rum_hot_idx ON test_rum_hot USING rum (t rum_tsvector_ops);
+SET rum.insert_buffer = off;
+INSERT INTO test_rum_hot
+	SELECT i, to_tsvector('simple', 'hot c' || (i % 3))
+	FROM generate_series(1, 20000) i;
+SELECT flags FROM rum_page_opaque_info('test_rum_hot_idx',
+	(SELECT posting_tree_root FROM rum_leaf_entry_page_items('test_rum_hot_idx', 1)
+	 WHERE key = 'hot'));
+DELETE FROM test_rum_hot WHERE id BETWEEN 2001 AND 12000 OR id > 19000;
+VACUUM test_rum_hot;
+INSERT INTO test_rum_hot
+	SELECT i, to_tsvector('simple', 'hot c' || (i % 3))
+	FROM generate_series(20001, 30000) i;
+RESET rum.insert_buffer;
+SELECT flags FROM rum_page_opaque_info('test_rum_hot_idx',
+	(SELECT posting_tree_root FROM rum_leaf_entry_page_items('test_rum_hot_idx', 1)
+	 WHERE key = 'hot'));
+SET enable_seqscan = off;
+SELECT count(*), min(id), max(id) FROM test_rum_hot WHERE t @@ 'hot';
+SELECT count(*) FROM test_rum_hot WHERE t @@ 'hot & c1';
+SELECT count(*) FROM test_rum_hot WHERE t @@ 'hot' AND id BETWEEN 2001 AND 12000;
+RESET enable_seqscan;
+DROP TABLE test_rum_hot;
+
+-- Appends to the posting lists of entry tuples, both into the alignment
+-- padding and by replacing the grown tuple, including keys of null
+-- categories and the addInfo ordered lists of order_by_attach
+CREATE TABLE test_rum_append (id int, t tsvector, d timestamp);
+CREATE INDEX test_rum_append_idx ON test_rum_append USING rum (t rum_tsvector_ops);
+CREATE INDEX test_rum_append_attach_idx ON test_rum_append
+	USING rum (t rum_tsvector_addon_ops, d)
+	WITH (attach = 'd', to = 't', order_by_attach = 't');
+SET rum.insert_buffer = off;
+INSERT INTO test_rum_append
+	SELECT i,
+		   CASE i % 3 WHEN 0 THEN NULL WHEN 1 THEN ''::tsvector
+		   ELSE to_tsvector('simple', 'a' || (i % 5)) END,
+		   '2016-05-01'::timestamp + i * interval '1 hour'
+	FROM generate_series(1, 300) i;
+-- these sort before the existing items of order_by_attach lists
+INSERT INTO test_rum_append
+	SELECT i, to_tsvector('simple', 'a' || (i % 5)),
+		   '2016-04-01'::timestamp + i * interval '1 hour'
+	FROM generate_series(301, 320) i;
+RESET rum.insert_buffer;
+SELECT category, count(*) FROM rum_leaf_entry_page_items('test_rum_append_idx', 1)
+	GROUP BY category ORDER BY category;
+SELECT count(*) FROM rum_leaf_entry_page_items('test_rum_append_idx', 1) e
+	JOIN test_rum_append a ON a.ctid = e.tuple_id
+WHERE e.category = CASE WHEN a.t IS NULL THEN 'RUM_CAT_NULL_ITEM'
+						WHEN a.t = ''::tsvector THEN 'RUM_CAT_EMPTY_ITEM'
+						ELSE 'RUM_CAT_NORM_KEY' END
+	AND e.key IS NOT DISTINCT FROM
+		CASE WHEN a.id % 3 = 2 OR a.id > 300 THEN 'a' || (a.id % 5) END;
+SELECT category, count(*) FROM rum_leaf_entry_page_items('test_rum_append_attach_idx', 1)
+	GROUP BY category ORDER BY category;
+SELECT count(*) FROM rum_leaf_entry_page_items('test_rum_append_attach_idx', 1) e
+	JOIN test_rum_append a ON a.ctid = e.tuple_id
+WHERE e.category = CASE WHEN a.t IS NULL THEN 'RUM_CAT_NULL_ITEM'
+						WHEN a.t = ''::tsvector THEN 'RUM_CAT_EMPTY_ITEM'
+						ELSE 'RUM_CAT_NORM_KEY' END
+	AND e.key IS NOT DISTINCT FROM
+		CASE WHEN a.id % 3 = 2 OR a.id > 300 THEN 'a' || (a.id % 5) END;
+SET enable_seqscan = off;
+SELECT count(*) FROM test_rum_append WHERE t @@ 'a1';
+SELECT count(*) FROM test_rum_append WHERE t @@ '!a1';
+DROP INDEX test_rum_append_idx;
+SELECT count(*) FROM test_rum_append WHERE t @@ 'a1';
+SELECT count(*) FROM test_rum_append WHERE t @@ '!a1';
+SELECT array_agg(id) FROM (
+	SELECT id FROM test_rum_append WHERE t @@ 'a1'
+	ORDER BY d <=> '2016-04-20' LIMIT 30) s;
+RESET enable_seqscan;
+DROP TABLE test_rum_append;
+
 -- Test correct work of phrase operator when position information is not in index.
 create table test_rum_addon as table test_rum;
 alter table test_rum_addon add column id serial;
@@ -0,0 +1,142 @@
+/*
+ * With rum.insert_buffer, inserts into a RUM index are buffered per
+ * statement on PostgreSQL 17+.  Older versions insert row by row and accept
+ * rum.insert_buffer as a placeholder, so the results are the same.
+ */
+CREATE TABLE test_rum_insert (id int, t tsvector);
+CREATE INDEX test_rum_insert_idx ON test_rum_insert USING rum (t rum_tsvector_ops);
+SET enable_seqscan = off;
+SET rum.insert_buffer = on;
+
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'k' || (i % 10) || ' common')
+	FROM generate_series(1, 1000) i;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'common';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'k3';
+
+-- Rollback to savepoint makes the buffered entries of its rows go away
+BEGIN;
+SAVEPOINT s1;
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'rolled common')
+	FROM generate_series(1001, 1100) i;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'common';
+ROLLBACK TO s1;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'common';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'rolled';
+SAVEPOINT s2;
+-- fails after most of the rows are buffered
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'failed common')
+	FROM generate_series(1101, 1200) i WHERE 1 / (1200 - i) >= 0;
+ROLLBACK TO s2;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'failed';
+COMMIT;
+
+-- Stale entries would point to the reused line pointers
+VACUUM test_rum_insert;
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'reused common')
+	FROM generate_series(1201, 1400) i;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'failed';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'rolled';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'reused';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'common';
+
+-- Release of savepoint hands the buffer to the parent transaction
+BEGIN;
+SAVEPOINT s3;
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'released common')
+	FROM generate_series(1401, 1450) i;
+RELEASE SAVEPOINT s3;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'released';
+COMMIT;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'released';
+CREATE FUNCTION test_rum_insert_nested(i int, fail bool) RETURNS tsvector AS $$
+BEGIN
+	BEGIN
+		INSERT INTO test_rum_insert VALUES (-i, to_tsvector('simple', 'nested'));
+		IF fail THEN
+			RAISE EXCEPTION 'nested insert of %', i;
+		END IF;
+	EXCEPTION WHEN raise_exception THEN
+		NULL;
+	END;
+	RETURN to_tsvector('simple', 'outer');
+END;
+$$ LANGUAGE plpgsql;
+INSERT INTO test_rum_insert
+	SELECT i, test_rum_insert_nested(i, i % 2 = 0)
+	FROM generate_series(1451, 1460) i;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'outer';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'nested';
+SELECT id FROM test_rum_insert WHERE t @@ 'nested' ORDER BY id;
+
+-- AFTER trigger fires before the end of statement and must see the rows
+CREATE FUNCTION test_rum_insert_count() RETURNS trigger AS $$
+BEGIN
+	RAISE NOTICE 'rows with "trig": %',
+		(SELECT count(*) FROM test_rum_insert WHERE t @@ 'trig');
+	RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER test_rum_insert_after
+AFTER INSERT ON test_rum_insert
+FOR EACH STATEMENT EXECUTE PROCEDURE test_rum_insert_count();
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'trig common')
+	FROM generate_series(1461, 1510) i;
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'trig')
+	FROM generate_series(1511, 1530) i;
+-- Parallel workers can't see the buffer, so it's flushed before the query
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET min_parallel_index_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SET parallel_leader_participation = off;
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'trig')
+	FROM generate_series(1531, 1580) i;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET min_parallel_index_scan_size;
+RESET max_parallel_workers_per_gather;
+RESET parallel_leader_participation;
+DROP TRIGGER test_rum_insert_after ON test_rum_insert;
+
+-- Small work_mem makes the buffer flush in the middle of the statement
+SET work_mem = '64kB';
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'w' || (i % 10) || ' u' || i)
+	FROM generate_series(2001, 7000) i;
+RESET work_mem;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'w3';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'w3 | w7';
+SELECT id FROM test_rum_insert WHERE t @@ 'u2001 | u4321 | u7000' ORDER BY id;
+
+-- Without the buffer rows are inserted one by one
+SET rum.insert_buffer = off;
+INSERT INTO test_rum_insert
+	SELECT i, to_tsvector('simple', 'unbuffered common')
+	FROM generate_series(7001, 7100) i;
+SET rum.insert_buffer = on;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'unbuffered';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'common';
+
+-- The heap agrees with the index
+RESET enable_seqscan;
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'common';
+SELECT count(*) FROM test_rum_insert WHERE t @@ 'w3 | w7';
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+
+RESET rum.insert_buffer;
+DROP TABLE test_rum_insert;
+DROP FUNCTION test_rum_insert_nested(int, bool);
+DROP FUNCTION test_rum_insert_count();
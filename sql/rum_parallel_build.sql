@@ -0,0 +1,44 @@
+/*
+ * ------------------------------------
+ *  NOTE: This test behaves differenly
+ * ------------------------------------
+ *
+ * rum_parallel_build.out - test output for PostgreSQL 17+, where
+ * index_build() plans the workers of the RUM build
+ * rum_parallel_build_1.out - test output for 12-16, where rumbuild() plans
+ * them itself
+ * rum_parallel_build_2.out - test output for 11, which builds RUM indexes
+ * serially
+ * rum_parallel_build_3.out - test output for 9.6 and 10, which don't report
+ * how the index is built
+ *
+ */
+CREATE TABLE test_rum_build (id int, a tsvector, d timestamp);
+INSERT INTO test_rum_build
+	SELECT i,
+		   to_tsvector('simple', 'w' || (i % 10) || ' x' || (i % 7) || ' y' || (i % 1000)),
+		   '2016-05-01'::timestamp + i * interval '1 minute'
+	FROM generate_series(1, 20000) i;
+
+-- The leader and two workers scan the heap, the leader merges their entries
+ALTER TABLE test_rum_build SET (parallel_workers = 2);
+SET max_parallel_maintenance_workers = 2;
+SET maintenance_work_mem = '128MB';
+SET client_min_messages = debug1;
+CREATE INDEX test_rum_build_idx ON test_rum_build USING rum (a rum_tsvector_ops);
+CREATE INDEX test_rum_build_addon_idx ON test_rum_build
+	USING rum (a rum_tsvector_addon_ops, d) WITH (attach = 'd', to = 'a');
+RESET client_min_messages;
+RESET maintenance_work_mem;
+RESET max_parallel_maintenance_workers;
+ALTER TABLE test_rum_build RESET (parallel_workers);
+
+SET enable_seqscan = off;
+SELECT count(*) FROM test_rum_build WHERE a @@ to_tsquery('simple', 'w1 | x3');
+SELECT count(*) FROM test_rum_build WHERE a @@ to_tsquery('simple', 'w1 & x3');
+SELECT id FROM test_rum_build WHERE a @@ to_tsquery('simple', 'y7 & x0') ORDER BY id;
+SELECT id, d FROM test_rum_build WHERE a @@ to_tsquery('simple', 'w3 & x5')
+	ORDER BY d <=> '2016-05-08 12:01:00' LIMIT 5;
+RESET enable_seqscan;
+
+DROP TABLE test_rum_build;
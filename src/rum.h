@@ -19,6 +19,7 @@
 #include "access/sdir.h"
 #include "lib/rbtree.h"
 #include "storage/bufmgr.h"
+#include "storage/spin.h"
 #include "utils/datum.h"
 #include "utils/memutils.h"
 #include "tsearch/ts_type.h"
@@ -332,8 +333,17 @@ typedef struct RumOptions
 	bool		useAlternativeOrder;
 	int			attachColumn;
 	int			addToColumn;
+	int			fillfactor;		/* posting tree leaf fill percentage */
 }	RumOptions;
 
+#define RUM_MIN_FILLFACTOR			10
+#define RUM_DEFAULT_FILLFACTOR		90
+
+#define RumGetFillFactor(relation) \
+	((relation)->rd_options ? \
+	 ((RumOptions *) (relation)->rd_options)->fillfactor : \
+	 RUM_DEFAULT_FILLFACTOR)
+
 #define ALT_ADD_INFO_NULL_FLAG		(0x8000)
 
 /* Macros for buffer lock/unlock operations */
@@ -355,6 +365,15 @@ typedef struct RumConfig
 /*
  * RumState: working data structure describing the index being worked on
  */
+/*
+ * Decoder of a run of leaf data page items, specialized for the additional
+ * information type of an index column.  See rumDataPageLeafReadItems().
+ */
+typedef Pointer (*RumLeafReadItemsFunc) (Pointer ptr, ItemPointer prev,
+										  RumItem * items, int nitems,
+										  bool copyAddInfo,
+										  Form_pg_attribute attr);
+
 typedef struct RumState
 {
 	Relation	index;
@@ -379,6 +398,7 @@ typedef struct RumState
 	TupleDesc	tupdesc[INDEX_MAX_KEYS];
 	RumConfig	rumConfig[INDEX_MAX_KEYS];
 	Form_pg_attribute addAttrs[INDEX_MAX_KEYS];
+	RumLeafReadItemsFunc leafReadItems[INDEX_MAX_KEYS];
 
 	/*
 	 * Per-index-column opclass support functions
@@ -460,7 +480,22 @@ extern bool ruminsert(Relation index, Datum *values, bool *isnull,
 		  );
 extern void rumEntryInsert(RumState * rumstate,
 			   OffsetNumber attnum, Datum key, RumNullCategory category,
-			   RumItem * items, uint32 nitem, GinStatsData *buildStats);
+			   RumItem * items, uint32 nitem, GinStatsData *buildStats,
+			   BlockNumber *leafHint);
+
+/*
+ * Statement-level insert buffer needs aminsertcleanup to be flushed at the
+ * end of statement, which is available starting from PostgreSQL 17.
+ */
+#if PG_VERSION_NUM >= 170000
+#define RUM_INSERT_BUFFER
+#endif
+
+#ifdef RUM_INSERT_BUFFER
+extern void ruminsertcleanup(Relation index, struct IndexInfo *indexInfo);
+extern void rumFlushPendingInserts(Relation index);
+extern void rumInsertBufferInit(void);
+#endif
 
 /* rumbtree.c */
 
@@ -522,8 +557,10 @@ extern RumBtreeStack *rumPrepareFindLeafPage(RumBtree btree, BlockNumber blkno);
 extern RumBtreeStack *rumFindLeafPage(RumBtree btree, RumBtreeStack * stack);
 extern RumBtreeStack *rumReFindLeafPage(RumBtree btree, RumBtreeStack * stack);
 extern Buffer rumStep(Buffer buffer, Relation index, int lockmode,
-					  ScanDirection scanDirection);
+					  ScanDirection scanDirection,
+					  BufferAccessStrategy strategy);
 extern void freeRumBtreeStack(RumBtreeStack * stack);
+extern void rumPlaceToPage(RumBtree btree, Buffer buffer, OffsetNumber off);
 extern void rumInsertValue(Relation index, RumBtree btree, RumBtreeStack * stack,
 			   GinStatsData *buildStats);
 extern void rumFindParents(RumBtree btree, RumBtreeStack * stack, BlockNumber rootBlkno);
@@ -547,6 +584,9 @@ extern int	rumCompareItemPointers(const ItemPointerData *a, const ItemPointerDat
 extern int	compareRumItem(RumState * state, const AttrNumber attno,
 						  const RumItem * a, const RumItem * b);
 extern void convertIndexToKey(RumDataLeafItemIndex *src, RumItem *dst);
+extern int	rumDataLeafIndexSearch(RumState * rumstate, OffsetNumber attnum,
+								   Page page, RumItem * item, bool equalOk,
+								   int *nentries);
 extern Pointer rumPlaceToDataPageLeaf(Pointer ptr, OffsetNumber attnum,
 					   RumItem * item, ItemPointer prev, RumState * rumstate);
 extern Size rumCheckPlaceToDataPageLeaf(OffsetNumber attnum,
@@ -555,13 +595,30 @@ extern uint32 rumMergeRumItems(RumState * rumstate, AttrNumber attno,
 							   RumItem * dst,
 							   RumItem * a, uint32 na,
 							   RumItem * b, uint32 nb);
+extern RumLeafReadItemsFunc rumSelectLeafReadItems(bool useAlternativeOrder,
+												  Form_pg_attribute attr);
 extern void RumDataPageAddItem(Page page, void *data, OffsetNumber offset);
 extern void RumPageDeletePostingItem(Page page, OffsetNumber offset);
 
+/* number of posting tree leaves prefetched ahead of a scan */
+#define RUM_LEAF_PREFETCH_DISTANCE	8
+/* leaves a scan steps through before it may switch to a bulk read ring */
+#define RUM_LEAF_BULKREAD_STEPS		32
+
 typedef struct
 {
 	RumBtreeData btree;
 	RumBtreeStack *stack;
+
+	/* leaf read-ahead, see rumPostingTreeStartPrefetch() */
+	ScanDirection prefetchDirection;
+	BlockNumber prefetchParent;	/* internal page with the next downlinks */
+	BlockNumber prefetchLast;	/* last prefetched leaf */
+	int			nPrefetched;	/* prefetched leaves not stepped to yet */
+
+	/* ring for long leaf chains, see rumPostingTreeStepPrefetch() */
+	int			nSteps;			/* leaves stepped to so far */
+	BufferAccessStrategy strategy;
 }	RumPostingTreeScan;
 
 extern RumPostingTreeScan *rumPrepareScanPostingTree(Relation index,
@@ -574,6 +631,10 @@ extern void rumInsertItemPointers(RumState * rumstate,
 					  RumItem * items, uint32 nitem,
 					  GinStatsData *buildStats);
 extern Buffer rumScanBeginPostingTree(RumPostingTreeScan * gdi, RumItem *item);
+extern void rumPostingTreeStartPrefetch(RumPostingTreeScan * gdi,
+										ScanDirection scanDirection);
+extern void rumPostingTreeStepPrefetch(RumPostingTreeScan * gdi,
+									   ScanDirection scanDirection);
 extern void rumDataFillRoot(RumBtree btree, Buffer root, Buffer lbuf, Buffer rbuf,
 				Page page, Page lpage, Page rpage);
 extern void rumPrepareDataScan(RumBtree btree, Relation index, OffsetNumber attnum, RumState * rumstate);
@@ -587,6 +648,28 @@ typedef struct RumScanItem
 	RumNullCategory keyCategory;
 }	RumScanItem;
 
+#define RUM_MATCH_MERGE_MAX_RUNS	64
+
+/*
+ * Items matching a partial match entry, collected as sorted runs (one per
+ * matching posting list or tree) to be merged instead of sorted.  Used while
+ * there are at most RUM_MATCH_MERGE_MAX_RUNS runs fitting in work_mem,
+ * otherwise items go to matchSortstate.
+ */
+typedef struct RumMatchMerge
+{
+	RumScanItem *items;
+	uint32		nitems;
+	uint32		maxitems;
+
+	uint32		runPos[RUM_MATCH_MERGE_MAX_RUNS];	/* next item of each run */
+	uint32		runEnd[RUM_MATCH_MERGE_MAX_RUNS];
+	int			nruns;
+
+	int			heap[RUM_MATCH_MERGE_MAX_RUNS];		/* runs by next item */
+	int			nheap;
+}	RumMatchMerge;
+
 /*
  * RumScanKeyData describes a single RUM index qualifier expression.
  *
@@ -690,6 +773,7 @@ typedef struct RumScanEntryData
 	 * and additional information here
 	 */
 	RumTuplesortstate *matchSortstate;
+	RumMatchMerge *matchMerge;
 	RumScanItem	collectRumItem;
 
 	/* for full-scan query with order-by */
@@ -753,6 +837,32 @@ typedef struct RumScanOpaqueData
 	int			norderbys;		/* Number of columns in ordering.
 								   Will be assigned to sortstate->nKeys */
 
+	/*
+	 * Bounded top-K mode of ordered scan, used instead of sortstate if
+	 * rum.sort_limit is set.  topKItems is a max-heap of the best sortBound
+	 * items while collecting and a sorted array while returning them.  If
+	 * more items are requested, the scan is restarted with a regular sort,
+	 * and returnedItems holds the sorted TIDs which are already returned.
+	 */
+	RumSortItem **topKItems;
+	int			sortBound;
+	int			nTopKItems;
+	int			curTopKItem;
+	bool		topKOverflow;	/* some items didn't fit into the heap */
+	ItemPointerData *returnedItems;
+	int			nReturnedItems;
+
+	/*
+	 * Look-ahead of rumgettuple(): a ring of the next prefetchDistance items
+	 * whose heap blocks are already prefetched.
+	 */
+	int			prefetchDistance;
+	RumSortItem **prefetchItems;
+	int			prefetchHead;
+	int			nPrefetchItems;
+	bool		prefetchFinished;	/* no more items to look ahead */
+	BlockNumber prefetchBlock;	/* last prefetched heap block */
+
 	RumItem		item;			/* current item used in index scan */
 	bool		firstCall;
 
@@ -778,10 +888,60 @@ typedef struct RumScanOpaqueData
 	 */
 	bool		scanWithAltOrderKeys;
 	RumTIDBitmap *tbm;
+
+	/*
+	 * While the tids of keys ordered by tid fit in work_mem, they are kept
+	 * exact as a sorted array (allocated in keyCtx) instead of the tbm.
+	 */
+	bool		useAltOrderTids;
+	ItemPointerData *altOrderTids;
+	int			nAltOrderTids;
+
+	/*
+	 * Parallel scan state.  If parallelChunks is true, this participant
+	 * returns only items of heap block chunks claimed by it, see
+	 * scanGetItemParallel().  hasNextItem means that so->item is fetched but
+	 * belongs to a chunk which isn't claimed yet.
+	 */
+	bool		parallelChunks;
+	BlockNumber	curChunk;
+	bool		hasNextItem;
+	bool		nextItemRecheck;
 }	RumScanOpaqueData;
 
 typedef RumScanOpaqueData *RumScanOpaque;
 
+/*
+ * Shared state of a parallel RUM index scan.
+ *
+ * Scans returning items in item pointer order are divided into chunks of
+ * rum.parallel_chunk_size heap blocks, which are claimed by participants in
+ * increasing order.  Other scans are run by a single participant.
+ */
+typedef struct RumParallelScanDescData
+{
+	slock_t		mutex;
+	BlockNumber	chunkBlocks;	/* heap blocks per chunk */
+	BlockNumber	nextChunk;		/* next chunk to be claimed */
+	bool		scanClaimed;	/* the whole scan is taken by a participant */
+}	RumParallelScanDescData;
+
+typedef RumParallelScanDescData *RumParallelScanDesc;
+
+/* Default and maximum of rum.parallel_chunk_size */
+#define RUM_PARALLEL_CHUNK_BLOCKS	1024
+#define RUM_PARALLEL_CHUNK_BLOCKS_MAX	(1024 * 1024)
+
+#if PG_VERSION_NUM >= 180000
+#define RumGetParallelScanDesc(scan) \
+	((RumParallelScanDesc) OffsetToPointer((scan)->parallel_scan, \
+										   (scan)->parallel_scan->ps_offset_am))
+#else
+#define RumGetParallelScanDesc(scan) \
+	((RumParallelScanDesc) OffsetToPointer((scan)->parallel_scan, \
+										   (scan)->parallel_scan->ps_offset))
+#endif
+
 extern IndexScanDesc rumbeginscan(Relation rel, int nkeys, int norderbys);
 extern void rumendscan(IndexScanDesc scan);
 extern void rumrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
@@ -790,10 +950,21 @@ extern Datum rummarkpos(PG_FUNCTION_ARGS);
 extern Datum rumrestrpos(PG_FUNCTION_ARGS);
 extern void rumNewScanKey(IndexScanDesc scan);
 extern void freeScanKeys(RumScanOpaque so);
+#if PG_VERSION_NUM >= 180000
+extern Size rumestimateparallelscan(Relation indexRelation,
+									int nkeys, int norderbys);
+#elif PG_VERSION_NUM >= 170000
+extern Size rumestimateparallelscan(int nkeys, int norderbys);
+#else
+extern Size rumestimateparallelscan(void);
+#endif
+extern void ruminitparallelscan(void *target);
+extern void rumparallelrescan(IndexScanDesc scan);
 
 /* rumget.c */
 extern int64 rumgetbitmap(IndexScanDesc scan, TIDBitmap *tbm);
 extern bool rumgettuple(IndexScanDesc scan, ScanDirection direction);
+extern void rumFreeMatchMerge(RumScanEntry entry);
 
 /* rumvacuum.c */
 extern IndexBulkDeleteResult *rumbulkdelete(IndexVacuumInfo *info,
@@ -892,6 +1063,12 @@ extern PGDLLEXPORT Datum rum_anyarray_distance(PG_FUNCTION_ARGS);
 
 /* GUC parameters */
 extern int		RumFuzzySearchLimit;
+extern int		RumSortLimit;
+extern int		RumHeapPrefetchDistance;
+extern int		RumParallelChunkSize;
+#ifdef RUM_INSERT_BUFFER
+extern bool		RumInsertBuffer;
+#endif
 extern float8	RumArraySimilarityThreshold;
 extern int		RumArraySimilarityFunction;
 
@@ -918,6 +1095,32 @@ rumDataPageLeafReadItemPointer(char *ptr, ItemPointer iptr, bool *addInfoIsNull)
 	int			i;
 	uint8		v;
 
+	/*
+	 * Fast path: both the block number increment and the offset fit into a
+	 * single byte, which is the common case for dense posting lists.  An item
+	 * pointer always takes at least two bytes, so reading ptr[1] is safe.
+	 */
+	if (((((uint8) ptr[0]) | ((uint8) ptr[1])) & HIGHBIT) == 0)
+	{
+		blockNumberIncr = (uint8) ptr[0];
+		v = (uint8) ptr[1];
+		ptr += 2;
+
+		if (blockNumberIncr != 0)
+		{
+			blockNumberIncr += iptr->ip_blkid.bi_lo + (iptr->ip_blkid.bi_hi << 16);
+			iptr->ip_blkid.bi_lo = blockNumberIncr & 0xFFFF;
+			iptr->ip_blkid.bi_hi = (blockNumberIncr >> 16) & 0xFFFF;
+		}
+
+		if (addInfoIsNull)
+			*addInfoIsNull = (v & SEVENTHBIT) ? true : false;
+		iptr->ip_posid = v & SIXMASK;
+		Assert(OffsetNumberIsValid(iptr->ip_posid));
+
+		return ptr;
+	}
+
 	i = 0;
 	do
 	{
@@ -1102,6 +1305,23 @@ rumDataPageLeafReadPointer(Pointer ptr, OffsetNumber attnum, RumItem * item,
 	return ptr;
 }
 
+/*
+ * Reads nitems consecutive items with additional information from leaf data
+ * page or posting list into items[].  prev is the item pointer preceding ptr,
+ * minimal item pointer should be passed to read from the beginning.  Unlike
+ * rumDataPageLeafRead(), the decoder is chosen once per index column by
+ * initRumState(), so per-item checks of the page format are avoided.
+ */
+static inline Pointer
+rumDataPageLeafReadItems(Pointer ptr, OffsetNumber attnum, ItemPointer prev,
+						 RumItem * items, int nitems, bool copyAddInfo,
+						 RumState * rumstate)
+{
+	return rumstate->leafReadItems[attnum - 1] (ptr, prev, items, nitems,
+												copyAddInfo,
+												rumstate->addAttrs[attnum - 1]);
+}
+
 extern Datum FunctionCall10Coll(FmgrInfo *flinfo, Oid collation,
 				   Datum arg1, Datum arg2,
 				   Datum arg3, Datum arg4, Datum arg5,
@@ -160,7 +160,7 @@ rumFindLeafPage(RumBtree btree, RumBtreeStack * stack)
 				break;
 
 			stack->buffer = rumStep(stack->buffer, btree->index, access,
-									ForwardScanDirection);
+									ForwardScanDirection, NULL);
 			stack->blkno = rightlink;
 			page = BufferGetPage(stack->buffer);
 		}
@@ -207,7 +207,7 @@ rumFindLeafPage(RumBtree btree, RumBtreeStack * stack)
  */
 Buffer
 rumStep(Buffer buffer, Relation index, int lockmode,
-			 ScanDirection scanDirection)
+			 ScanDirection scanDirection, BufferAccessStrategy strategy)
 {
 	Buffer		nextbuffer;
 	Page		page = BufferGetPage(buffer);
@@ -225,7 +225,8 @@ rumStep(Buffer buffer, Relation index, int lockmode,
 		return InvalidBuffer;
 	}
 
-	nextbuffer = ReadBuffer(index, blkno);
+	nextbuffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									strategy);
 	UnlockReleaseBuffer(buffer);
 	LockBuffer(nextbuffer, lockmode);
 
@@ -338,7 +339,7 @@ rumFindParents(RumBtree btree, RumBtreeStack * stack,
 				break;
 			}
 			buffer = rumStep(buffer, btree->index, RUM_EXCLUSIVE,
-							 ForwardScanDirection);
+							 ForwardScanDirection, NULL);
 			page = BufferGetPage(buffer);
 		}
 
@@ -358,6 +359,38 @@ rumFindParents(RumBtree btree, RumBtreeStack * stack,
 	}
 }
 
+/*
+ * Place value (stored in RumBtree) to the exclusively locked page, which
+ * has enough space for it.
+ */
+void
+rumPlaceToPage(RumBtree btree, Buffer buffer, OffsetNumber off)
+{
+	GenericXLogState *state = NULL;
+	Page		page;
+
+	if (btree->rumstate->isBuild)
+	{
+		page = BufferGetPage(buffer);
+		START_CRIT_SECTION();
+	}
+	else
+	{
+		state = GenericXLogStart(btree->index);
+		page = GenericXLogRegisterBuffer(state, buffer, 0);
+	}
+
+	btree->placeToPage(btree, page, off);
+
+	if (btree->rumstate->isBuild)
+	{
+		MarkBufferDirty(buffer);
+		END_CRIT_SECTION();
+	}
+	else
+		GenericXLogFinish(state);
+}
+
 /*
  * Insert value (stored in RumBtree) to tree described by stack
  *
@@ -397,26 +430,7 @@ rumInsertValue(Relation index, RumBtree btree, RumBtreeStack * stack,
 
 		if (btree->isEnoughSpace(btree, stack->buffer, stack->off))
 		{
-			if (btree->rumstate->isBuild)
-			{
-				page = BufferGetPage(stack->buffer);
-				START_CRIT_SECTION();
-			}
-			else
-			{
-				state = GenericXLogStart(index);
-				page = GenericXLogRegisterBuffer(state, stack->buffer, 0);
-			}
-
-			btree->placeToPage(btree, page, stack->off);
-
-			if (btree->rumstate->isBuild)
-			{
-				MarkBufferDirty(stack->buffer);
-				END_CRIT_SECTION();
-			}
-			else
-				GenericXLogFinish(state);
+			rumPlaceToPage(btree, stack->buffer, stack->off);
 
 			LockBuffer(stack->buffer, RUM_UNLOCK);
 			freeRumBtreeStack(stack);
@@ -630,7 +644,7 @@ rumInsertValue(Relation index, RumBtree btree, RumBtreeStack * stack,
 			}
 
 			parent->buffer = rumStep(parent->buffer, btree->index,
-									 RUM_EXCLUSIVE, ForwardScanDirection);
+									 RUM_EXCLUSIVE, ForwardScanDirection, NULL);
 			parent->blkno = rightlink;
 			page = BufferGetPage(parent->buffer);
 		}
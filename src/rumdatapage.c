@@ -304,6 +304,163 @@ rumCheckPlaceToDataPageLeaf(OffsetNumber attnum,
 	return size;
 }
 
+#ifndef pg_attribute_always_inline
+#define pg_attribute_always_inline inline
+#endif
+
+/*
+ * Body of leaf items decoders.  It is inlined into the specialized functions
+ * below with constant altOrder and addInfoLen, so the compiler removes the
+ * branches on page format and additional information type from the loop.
+ * addInfoLen is 0 for columns without additional information, attlen of
+ * pass-by-value additional information or -1 for pass-by-reference one.
+ */
+static pg_attribute_always_inline Pointer
+leafReadItemsImpl(Pointer ptr, ItemPointer prev, RumItem * items, int nitems,
+				  bool copyAddInfo, Form_pg_attribute attr,
+				  bool altOrder, int addInfoLen)
+{
+	ItemPointerData iptr = *prev;
+	int			i;
+
+	for (i = 0; i < nitems; i++)
+	{
+		RumItem    *item = &items[i];
+
+		if (altOrder)
+		{
+			memcpy(&item->iptr, ptr, sizeof(ItemPointerData));
+			ptr += sizeof(ItemPointerData);
+
+			item->addInfoIsNull =
+				(item->iptr.ip_posid & ALT_ADD_INFO_NULL_FLAG) ? true : false;
+			item->iptr.ip_posid &= ~ALT_ADD_INFO_NULL_FLAG;
+		}
+		else
+		{
+			ptr = rumDataPageLeafReadItemPointer(ptr, &iptr,
+												 &item->addInfoIsNull);
+			item->iptr = iptr;
+		}
+
+		Assert(item->iptr.ip_posid != InvalidOffsetNumber);
+
+		if (item->addInfoIsNull)
+		{
+			item->addInfo = (Datum) 0;
+			continue;
+		}
+
+		/* do not use aligment for pass-by-value types */
+		switch (addInfoLen)
+		{
+			case sizeof(char):
+				item->addInfo = Int8GetDatum(*ptr);
+				ptr += sizeof(char);
+				break;
+			case sizeof(int16):
+				{
+					int16		v;
+
+					memcpy(&v, ptr, sizeof(int16));
+					item->addInfo = Int16GetDatum(v);
+					ptr += sizeof(int16);
+				}
+				break;
+			case sizeof(int32):
+				{
+					int32		v;
+
+					memcpy(&v, ptr, sizeof(int32));
+					item->addInfo = Int32GetDatum(v);
+					ptr += sizeof(int32);
+				}
+				break;
+#if SIZEOF_DATUM == 8
+			case sizeof(Datum):
+				memcpy(&item->addInfo, ptr, sizeof(Datum));
+				ptr += sizeof(Datum);
+				break;
+#endif
+			case -1:
+				ptr = (Pointer) att_align_pointer(ptr, attr->attalign,
+												  attr->attlen, ptr);
+				item->addInfo = copyAddInfo ?
+					datumCopy(PointerGetDatum(ptr), false, attr->attlen) :
+					PointerGetDatum(ptr);
+				ptr = (Pointer) att_addlength_pointer(ptr, attr->attlen, ptr);
+				break;
+			default:
+				elog(ERROR, "unexpected additional information in leaf item");
+		}
+	}
+
+	return ptr;
+}
+
+#define LEAF_READ_ITEMS_FUNC(name, altOrder, addInfoLen) \
+static Pointer \
+name(Pointer ptr, ItemPointer prev, RumItem * items, int nitems, \
+	 bool copyAddInfo, Form_pg_attribute attr) \
+{ \
+	return leafReadItemsImpl(ptr, prev, items, nitems, copyAddInfo, attr, \
+							 (altOrder), (addInfoLen)); \
+}
+
+LEAF_READ_ITEMS_FUNC(leafReadItemsNoAddInfo, false, 0)
+LEAF_READ_ITEMS_FUNC(leafReadItemsChar, false, sizeof(char))
+LEAF_READ_ITEMS_FUNC(leafReadItemsInt16, false, sizeof(int16))
+LEAF_READ_ITEMS_FUNC(leafReadItemsInt32, false, sizeof(int32))
+LEAF_READ_ITEMS_FUNC(leafReadItemsByRef, false, -1)
+LEAF_READ_ITEMS_FUNC(leafReadItemsAltNoAddInfo, true, 0)
+LEAF_READ_ITEMS_FUNC(leafReadItemsAltChar, true, sizeof(char))
+LEAF_READ_ITEMS_FUNC(leafReadItemsAltInt16, true, sizeof(int16))
+LEAF_READ_ITEMS_FUNC(leafReadItemsAltInt32, true, sizeof(int32))
+LEAF_READ_ITEMS_FUNC(leafReadItemsAltByRef, true, -1)
+#if SIZEOF_DATUM == 8
+LEAF_READ_ITEMS_FUNC(leafReadItemsInt64, false, sizeof(Datum))
+LEAF_READ_ITEMS_FUNC(leafReadItemsAltInt64, true, sizeof(Datum))
+#endif
+
+/*
+ * Choose leaf items decoder for index column with given additional
+ * information attribute (NULL if the column has none).
+ */
+RumLeafReadItemsFunc
+rumSelectLeafReadItems(bool useAlternativeOrder, Form_pg_attribute attr)
+{
+	if (attr == NULL)
+		return useAlternativeOrder ? leafReadItemsAltNoAddInfo :
+			leafReadItemsNoAddInfo;
+
+	if (!attr->attbyval)
+		return useAlternativeOrder ? leafReadItemsAltByRef :
+			leafReadItemsByRef;
+
+	switch (attr->attlen)
+	{
+		case sizeof(char):
+			return useAlternativeOrder ? leafReadItemsAltChar :
+				leafReadItemsChar;
+		case sizeof(int16):
+			return useAlternativeOrder ? leafReadItemsAltInt16 :
+				leafReadItemsInt16;
+		case sizeof(int32):
+			return useAlternativeOrder ? leafReadItemsAltInt32 :
+				leafReadItemsInt32;
+#if SIZEOF_DATUM == 8
+		case sizeof(Datum):
+			return useAlternativeOrder ? leafReadItemsAltInt64 :
+				leafReadItemsInt64;
+#endif
+		default:
+			elog(ERROR, "unsupported byval length: %d",
+				 (int) (attr->attlen));
+	}
+
+	return NULL;				/* keep compiler quiet */
+}
+
 int
 rumCompareItemPointers(const ItemPointerData *a, const ItemPointerData *b)
 {
@@ -407,6 +564,50 @@ rumMergeRumItems(RumState * rumstate, AttrNumber attno, RumItem * dst,
 	return dptr - dst;
 }
 
+/*
+ * Binary search over the item index at the end of leaf data page.  Returns
+ * the number of leading index entries which are less than item (or less than
+ * or equal to it if equalOk is false), i.e. which can be skipped when looking
+ * for item on the page.  *nentries is set to the number of used entries.
+ */
+int
+rumDataLeafIndexSearch(RumState * rumstate, OffsetNumber attnum, Page page,
+					   RumItem * item, bool equalOk, int *nentries)
+{
+	RumDataLeafItemIndex *indexes = RumPageGetIndexes(page);
+	int			low = 0,
+				high = 0;
+
+	/* Used entries go first, the rest are InvalidOffsetNumber */
+	while (high < RumDataLeafIndexCount &&
+		   indexes[high].offsetNumer != InvalidOffsetNumber)
+		high++;
+	*nentries = high;
+
+	while (high > low)
+	{
+		int			mid = low + (high - low) / 2;
+		int			cmp;
+
+		if (rumstate->useAlternativeOrder)
+		{
+			RumItem		k;
+
+			convertIndexToKey(&indexes[mid], &k);
+			cmp = compareRumItem(rumstate, attnum, &k, item);
+		}
+		else
+			cmp = rumCompareItemPointers(&indexes[mid].iptr, &item->iptr);
+
+		if (cmp < 0 || (cmp == 0 && !equalOk))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
 /*
  * Checks, should we move to right link...
  * Compares inserting item pointer with right bound of current page
@@ -534,7 +735,9 @@ findInLeafPage(RumBtree btree, Page page, OffsetNumber *offset,
 				maxoff,
 				first = FirstOffsetNumber;
 	RumItem		item;
-	int			cmp;
+	int			cmp,
+				j,
+				nentries;
 
 	Assert(RumPageIsData(page));
 	Assert(RumPageIsLeaf(page));
@@ -546,41 +749,18 @@ findInLeafPage(RumBtree btree, Page page, OffsetNumber *offset,
 	 * At first, search index at the end of page. As the result we narrow
 	 * [first, maxoff] range.
 	 */
-	for (i = 0; i < RumDataLeafIndexCount; i++)
+	j = rumDataLeafIndexSearch(btree->rumstate, btree->entryAttnum, page,
+							   &btree->items[btree->curitem], true, &nentries);
+	if (j > 0)
 	{
-		RumDataLeafItemIndex *index = RumPageGetIndexes(page) + i;
-
-		if (index->offsetNumer == InvalidOffsetNumber)
-			break;
-
-		if (btree->rumstate->useAlternativeOrder)
-		{
-			RumItem		k;
-
-			convertIndexToKey(index, &k);
-			cmp = compareRumItem(btree->rumstate,
-								 btree->entryAttnum, &k,
-								 &btree->items[btree->curitem]);
+		RumDataLeafItemIndex *index = RumPageGetIndexes(page) + j - 1;
 
-		}
-		else
-		{
-			cmp = rumCompareItemPointers(&index->iptr,
-										 &btree->items[btree->curitem].iptr);
-		}
-
-		if (cmp < 0)
-		{
-			ptr = RumDataPageGetData(page) + index->pageOffset;
-			first = index->offsetNumer;
-			item.iptr = index->iptr;
-		}
-		else
-		{
-			maxoff = index->offsetNumer - 1;
-			break;
-		}
+		ptr = RumDataPageGetData(page) + index->pageOffset;
+		first = index->offsetNumer;
+		item.iptr = index->iptr;
 	}
+	if (j < nentries)
+		maxoff = RumPageGetIndexes(page)[j].offsetNumer - 1;
 
 	/* Search page in [first, maxoff] range found by page index */
 	for (i = first; i <= maxoff; i++)
@@ -1502,9 +1682,150 @@ rumPrepareScanPostingTree(Relation index, BlockNumber rootBlkno,
 
 	gdi->stack = rumPrepareFindLeafPage(&gdi->btree, rootBlkno);
 
+	gdi->prefetchDirection = scanDirection;
+	gdi->prefetchParent = InvalidBlockNumber;
+	gdi->prefetchLast = InvalidBlockNumber;
+	gdi->nPrefetched = 0;
+	gdi->nSteps = 0;
+	gdi->strategy = NULL;
+
 	return gdi;
 }
 
+/*
+ * Backend-local cache of the rightmost leaves of posting trees, similar to
+ * the rightmost leaf fastpath of nbtree.  Heap TIDs of new tuples usually
+ * sort after all the existing ones, so nearly every insertion into a
+ * posting tree goes to its rightmost leaf and the descent from the root can
+ * be skipped.
+ *
+ * The cached leaf is used only if its LSN is the one left by our own
+ * insertion into it, since a split, deletion or reuse of the page would
+ * change it.  Unlogged pages don't get an LSN, so the cache is used only for
+ * WAL-logged indexes and during index build.  Trees of the alternative order
+ * are not ordered by TID and don't use it either.
+ *
+ * During index build pages aren't WAL-logged and have no LSN, so the LSN
+ * check compares zero to zero and proves nothing.  There the cache relies
+ * on the RumPageRightMost() check alone: a split of the cached leaf gives
+ * it a right sibling (or turns the root into an internal page), and the
+ * build is the only process modifying the index, so nothing can delete or
+ * reuse the leaf concurrently.  WAL-logging the pages at the end of the
+ * build stamps them with an LSN, so leaves cached by the build are not used
+ * by later insertions.
+ */
+#define RUM_RIGHTMOST_CACHE_SIZE 64
+
+typedef struct RumRightmostLeaf
+{
+	Oid			relid;
+	Oid			relfilenode;
+	BlockNumber rootBlkno;
+	BlockNumber leafBlkno;
+	XLogRecPtr	lsn;			/* LSN of the leaf after our insertion */
+	ItemPointerData lastItem;	/* last item we've inserted to the leaf */
+}	RumRightmostLeaf;
+
+static RumRightmostLeaf rightmostLeafCache[RUM_RIGHTMOST_CACHE_SIZE];
+
+static bool
+rightmostLeafUsable(RumBtree btree)
+{
+	RumState   *rumstate = btree->rumstate;
+
+	if (rumstate->useAlternativeOrder &&
+		btree->entryAttnum == rumstate->attrnAddToColumn)
+		return false;
+
+	return rumstate->isBuild || RelationNeedsWAL(btree->index);
+}
+
+static RumRightmostLeaf *
+rightmostLeafGet(RumBtree btree, BlockNumber rootBlkno)
+{
+	Oid			relid = RelationGetRelid(btree->index);
+
+	return &rightmostLeafCache[(relid * 31 + rootBlkno) %
+							   RUM_RIGHTMOST_CACHE_SIZE];
+}
+
+/*
+ * Returns the cached rightmost leaf of the posting tree if the current item
+ * should go there, or NULL.  The leaf is read and checked by the caller.
+ */
+static RumRightmostLeaf *
+rightmostLeafLookup(RumBtree btree, BlockNumber rootBlkno)
+{
+	RumRightmostLeaf *cached = rightmostLeafGet(btree, rootBlkno);
+
+	if (cached->relid != RelationGetRelid(btree->index) ||
+		cached->relfilenode != btree->index->rd_rel->relfilenode ||
+		cached->rootBlkno != rootBlkno)
+		return NULL;
+
+	/* the item belongs to the rightmost leaf only if it's after our last one */
+	if (ItemPointerCompare(&btree->items[btree->curitem].iptr,
+						   &cached->lastItem) <= 0)
+		return NULL;
+
+	return cached;
+}
+
+/*
+ * Lock the cached leaf exclusively and check that it's still the rightmost
+ * leaf of the tree and has enough space for the current item.
+ */
+static RumBtreeStack *
+rightmostLeafLock(RumBtree btree, RumRightmostLeaf * cached)
+{
+	RumBtreeStack *stack = (RumBtreeStack *) palloc(sizeof(RumBtreeStack));
+	Page		page;
+
+	stack->blkno = cached->leafBlkno;
+	stack->buffer = ReadBuffer(btree->index, cached->leafBlkno);
+	stack->off = InvalidOffsetNumber;
+	stack->predictNumber = 1;
+	stack->parent = NULL;
+
+	LockBuffer(stack->buffer, RUM_EXCLUSIVE);
+	page = BufferGetPage(stack->buffer);
+
+	if (PageGetLSN(page) != cached->lsn ||
+		!RumPageIsData(page) || !RumPageIsLeaf(page) ||
+		RumPageIsDeleted(page) || !RumPageRightMost(page) ||
+		!btree->isEnoughSpace(btree, stack->buffer, stack->off))
+	{
+		LockBuffer(stack->buffer, RUM_UNLOCK);
+		freeRumBtreeStack(stack);
+		return NULL;
+	}
+
+	return stack;
+}
+
+/*
+ * Place items to the locked rightmost leaf, which has enough space, and
+ * remember it.  The stack is released.
+ */
+static void
+rightmostLeafInsert(RumBtree btree, RumBtreeStack * stack,
+					BlockNumber rootBlkno)
+{
+	RumRightmostLeaf *cached = rightmostLeafGet(btree, rootBlkno);
+
+	rumPlaceToPage(btree, stack->buffer, stack->off);
+
+	cached->relid = RelationGetRelid(btree->index);
+	cached->relfilenode = btree->index->rd_rel->relfilenode;
+	cached->rootBlkno = rootBlkno;
+	cached->leafBlkno = stack->blkno;
+	cached->lsn = PageGetLSN(BufferGetPage(stack->buffer));
+	cached->lastItem = btree->items[btree->curitem - 1].iptr;
+
+	LockBuffer(stack->buffer, RUM_UNLOCK);
+	freeRumBtreeStack(stack);
+}
+
 /*
  * Inserts array of item pointers, may execute several tree scan (very rare)
  */
@@ -1516,19 +1837,70 @@ rumInsertItemPointers(RumState * rumstate,
 					  GinStatsData *buildStats)
 {
 	BlockNumber rootBlkno;
+	bool		useCache;
 
 	Assert(gdi->stack);
 	rootBlkno = gdi->stack->blkno;
 	gdi->btree.items = items;
 	gdi->btree.nitem = nitem;
 	gdi->btree.curitem = 0;
+	useCache = rightmostLeafUsable(&gdi->btree);
 
 	while (gdi->btree.curitem < gdi->btree.nitem)
 	{
+		RumRightmostLeaf *cached = NULL;
+		RumBtreeStack *stack = NULL;
+		Page		page;
+
+		if (useCache)
+			cached = rightmostLeafLookup(&gdi->btree, rootBlkno);
+
+		if (cached)
+		{
+			Buffer		rootBuffer;
+
+			/*
+			 * Keep the root pinned like a descent does, but don't hold its
+			 * lock while waiting for the leaf.
+			 */
+			if (gdi->stack)
+			{
+				LockBuffer(gdi->stack->buffer, RUM_UNLOCK);
+				rootBuffer = gdi->stack->buffer;
+				gdi->stack->buffer = InvalidBuffer;
+				freeRumBtreeStack(gdi->stack);
+			}
+			else
+				rootBuffer = ReadBuffer(rumstate->index, rootBlkno);
+
+			stack = rightmostLeafLock(&gdi->btree, cached);
+			if (stack)
+			{
+				if (gdi->btree.findItem(&(gdi->btree), stack))
+				{
+					/* the item already exists in index */
+					gdi->btree.curitem++;
+					LockBuffer(stack->buffer, RUM_UNLOCK);
+					freeRumBtreeStack(stack);
+				}
+				else
+					rightmostLeafInsert(&gdi->btree, stack, rootBlkno);
+
+				ReleaseBuffer(rootBuffer);
+				gdi->stack = NULL;
+				continue;
+			}
+
+			/* descend from the root as usual */
+			gdi->stack = rumPrepareFindLeafPage(&gdi->btree, rootBlkno);
+			ReleaseBuffer(rootBuffer);
+		}
+
 		if (!gdi->stack)
 			gdi->stack = rumPrepareFindLeafPage(&gdi->btree, rootBlkno);
 
 		gdi->stack = rumFindLeafPage(&gdi->btree, gdi->stack);
+		page = BufferGetPage(gdi->stack->buffer);
 
 		if (gdi->btree.findItem(&(gdi->btree), gdi->stack))
 		{
@@ -1539,6 +1911,11 @@ rumInsertItemPointers(RumState * rumstate,
 			LockBuffer(gdi->stack->buffer, RUM_UNLOCK);
 			freeRumBtreeStack(gdi->stack);
 		}
+		else if (useCache && gdi->stack->blkno != rootBlkno &&
+				 RumPageRightMost(page) &&
+				 gdi->btree.isEnoughSpace(&(gdi->btree), gdi->stack->buffer,
+										  gdi->stack->off))
+			rightmostLeafInsert(&gdi->btree, gdi->stack, rootBlkno);
 		else
 			rumInsertValue(rumstate->index, &(gdi->btree), gdi->stack, buildStats);
 
@@ -1560,3 +1937,151 @@ rumScanBeginPostingTree(RumPostingTreeScan * gdi, RumItem *item)
 	gdi->stack = rumFindLeafPage(&gdi->btree, gdi->stack);
 	return gdi->stack->buffer;
 }
+
+/*
+ * Prefetch posting tree leaves following prefetchLast in the scan direction.
+ * Their block numbers are taken from the downlinks of the parent internal
+ * page and of its siblings, because the leaf chain can't be followed without
+ * reading the leaves.  It's only a hint, so downlinks made stale by
+ * concurrent splits are harmless: the read-ahead just stops.
+ */
+static void
+postingTreePrefetchLeaves(RumPostingTreeScan * gdi)
+{
+#ifdef USE_PREFETCH
+	Relation	index = gdi->btree.index;
+	bool		forward = ScanDirectionIsForward(gdi->prefetchDirection);
+
+	while (gdi->nPrefetched < RUM_LEAF_PREFETCH_DISTANCE &&
+		   gdi->prefetchParent != InvalidBlockNumber)
+	{
+		Buffer		buffer;
+		Page		page;
+		OffsetNumber off,
+					maxoff;
+
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, gdi->prefetchParent,
+									RBM_NORMAL, gdi->strategy);
+
+		/*
+		 * The scan usually holds a lock on a leaf, so don't wait for the
+		 * parent lock as it could deadlock with a split.  Just try again on
+		 * the next step.
+		 */
+		if (!ConditionalLockBuffer(buffer))
+		{
+			ReleaseBuffer(buffer);
+			break;
+		}
+		page = BufferGetPage(buffer);
+
+		if (!RumPageIsData(page) || RumPageIsLeaf(page) ||
+			RumPageIsDeleted(page))
+		{
+			UnlockReleaseBuffer(buffer);
+			gdi->prefetchParent = InvalidBlockNumber;
+			break;
+		}
+
+		maxoff = RumPageGetOpaque(page)->maxoff;
+
+		/* Find the last prefetched downlink, or start from the page edge */
+		if (gdi->prefetchLast == InvalidBlockNumber)
+			off = forward ? FirstOffsetNumber : maxoff;
+		else
+		{
+			for (off = FirstOffsetNumber; off <= maxoff; off++)
+			{
+				RumPostingItem *pitem = (RumPostingItem *) RumDataPageGetItem(page, off);
+
+				if (RumPostingItemGetBlockNumber(pitem) == gdi->prefetchLast)
+					break;
+			}
+
+			if (off > maxoff)
+			{
+				UnlockReleaseBuffer(buffer);
+				gdi->prefetchParent = InvalidBlockNumber;
+				break;
+			}
+
+			off = forward ? off + 1 : off - 1;
+		}
+
+		while (off >= FirstOffsetNumber && off <= maxoff &&
+			   gdi->nPrefetched < RUM_LEAF_PREFETCH_DISTANCE)
+		{
+			RumPostingItem *pitem = (RumPostingItem *) RumDataPageGetItem(page, off);
+
+			gdi->prefetchLast = RumPostingItemGetBlockNumber(pitem);
+			PrefetchBuffer(index, MAIN_FORKNUM, gdi->prefetchLast);
+			gdi->nPrefetched++;
+
+			off = forward ? off + 1 : off - 1;
+		}
+
+		/* Downlinks of this page are over, continue with its sibling */
+		if (off < FirstOffsetNumber || off > maxoff)
+		{
+			gdi->prefetchParent = forward ?
+				RumPageGetOpaque(page)->rightlink :
+				RumPageGetOpaque(page)->leftlink;
+			gdi->prefetchLast = InvalidBlockNumber;
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+#endif
+}
+
+/*
+ * Start leaf read-ahead from the leaf page the scan has descended to.
+ */
+void
+rumPostingTreeStartPrefetch(RumPostingTreeScan * gdi,
+							ScanDirection scanDirection)
+{
+	gdi->prefetchDirection = scanDirection;
+	gdi->nPrefetched = 0;
+
+	if (gdi->stack->parent == NULL)
+	{
+		/* the root is a leaf */
+		gdi->prefetchParent = InvalidBlockNumber;
+		return;
+	}
+
+	gdi->prefetchParent = gdi->stack->parent->blkno;
+	gdi->prefetchLast = gdi->stack->blkno;
+
+	postingTreePrefetchLeaves(gdi);
+}
+
+/*
+ * The scan stepped to the next leaf: keep the read-ahead window filled.
+ *
+ * Once the scan turns out to walk a long leaf chain of an index that doesn't
+ * fit in a quarter of shared buffers (the heap seqscan threshold), further
+ * leaves and their parents are read through a BAS_BULKREAD ring, so that a
+ * large posting tree doesn't evict the rest of the buffer cache.
+ */
+void
+rumPostingTreeStepPrefetch(RumPostingTreeScan * gdi,
+						   ScanDirection scanDirection)
+{
+	if (++gdi->nSteps == RUM_LEAF_BULKREAD_STEPS && gdi->strategy == NULL &&
+		RelationGetNumberOfBlocks(gdi->btree.index) > NBuffers / 4)
+		gdi->strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	if (scanDirection != gdi->prefetchDirection)
+	{
+		rumPostingTreeStartPrefetch(gdi, scanDirection);
+		return;
+	}
+
+	if (gdi->nPrefetched > 0)
+		gdi->nPrefetched--;
+
+	if (gdi->nPrefetched <= RUM_LEAF_PREFETCH_DISTANCE / 2)
+		postingTreePrefetchLeaves(gdi);
+}
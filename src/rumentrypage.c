@@ -23,17 +23,12 @@ void
 rumReadTuple(RumState * rumstate, OffsetNumber attnum,
 			 IndexTuple itup, RumItem * items, bool copyAddInfo)
 {
-	Pointer		ptr = RumGetPosting(itup);
-	RumItem		item;
-	int			nipd = RumGetNPosting(itup),
-				i;
+	ItemPointerData iptr;
 
-	RumItemPointerSetMin(&item.iptr);
-	for (i = 0; i < nipd; i++)
-	{
-		ptr = rumDataPageLeafRead(ptr, attnum, &item, copyAddInfo, rumstate);
-		items[i] = item;
-	}
+	RumItemPointerSetMin(&iptr);
+	rumDataPageLeafReadItems(RumGetPosting(itup), attnum, &iptr,
+							 items, RumGetNPosting(itup), copyAddInfo,
+							 rumstate);
 }
 
 /*
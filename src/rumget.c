@@ -28,8 +28,11 @@
 #endif
 #include "rum.h"
 
-/* GUC parameter */
+/* GUC parameters */
 int			RumFuzzySearchLimit = 0;
+int			RumSortLimit = 0;
+int			RumHeapPrefetchDistance = 0;
+int			RumParallelChunkSize = RUM_PARALLEL_CHUNK_BLOCKS;
 
 static bool scanPage(RumState * rumstate, RumScanEntry entry, RumItem *item,
 					 bool equalOk);
@@ -202,7 +205,7 @@ moveRightIfItNeeded(RumBtreeData * btree, RumBtreeStack * stack)
 			return false;		/* no more pages */
 
 		stack->buffer = rumStep(stack->buffer, btree->index, RUM_SHARE,
-								ForwardScanDirection);
+								ForwardScanDirection, NULL);
 		stack->blkno = BufferGetBlockNumber(stack->buffer);
 		stack->off = FirstOffsetNumber;
 	}
@@ -210,9 +213,181 @@ moveRightIfItNeeded(RumBtreeData * btree, RumBtreeStack * stack)
 	return true;
 }
 
+/*
+ * Move items collected for merge into tuplesort, when there are too many
+ * runs or items to merge them in memory.
+ */
+static void
+matchMergeSpill(RumScanEntry scanEntry)
+{
+	RumMatchMerge *merge = scanEntry->matchMerge;
+	uint32		i;
+
+	scanEntry->matchSortstate = rum_tuplesort_begin_rumitem(work_mem, NULL);
+	for (i = 0; i < merge->nitems; i++)
+		rum_tuplesort_putrumitem(scanEntry->matchSortstate, &merge->items[i]);
+
+	rumFreeMatchMerge(scanEntry);
+}
+
+void
+rumFreeMatchMerge(RumScanEntry entry)
+{
+	pfree(entry->matchMerge->items);
+	pfree(entry->matchMerge);
+	entry->matchMerge = NULL;
+}
+
+/*
+ * Save an item matching partial match entry.  Items of each posting list or
+ * tree come in ascending order, so we keep them as sorted runs and merge the
+ * runs later, which is cheaper than sorting and doesn't need temp files.
+ */
+static void
+collectMatchItem(RumScanEntry scanEntry, RumScanItem *item)
+{
+	RumMatchMerge *merge = scanEntry->matchMerge;
+
+	if (merge == NULL)
+	{
+		rum_tuplesort_putrumitem(scanEntry->matchSortstate, item);
+		return;
+	}
+
+	/* Item doesn't continue the last run, so start a new one */
+	if (merge->nitems == 0 ||
+		rumCompareItemPointers(&merge->items[merge->nitems - 1].item.iptr,
+							   &item->item.iptr) >= 0)
+	{
+		if (merge->nruns >= RUM_MATCH_MERGE_MAX_RUNS)
+		{
+			matchMergeSpill(scanEntry);
+			rum_tuplesort_putrumitem(scanEntry->matchSortstate, item);
+			return;
+		}
+
+		merge->runPos[merge->nruns] = merge->nitems;
+		merge->nruns++;
+	}
+
+	if (merge->nitems >= merge->maxitems)
+	{
+		if ((Size) merge->maxitems * 2 * sizeof(RumScanItem) >
+			(Size) work_mem * 1024L)
+		{
+			matchMergeSpill(scanEntry);
+			rum_tuplesort_putrumitem(scanEntry->matchSortstate, item);
+			return;
+		}
+
+		merge->maxitems *= 2;
+		merge->items = (RumScanItem *)
+			repalloc(merge->items, sizeof(RumScanItem) * merge->maxitems);
+	}
+
+	merge->items[merge->nitems++] = *item;
+	merge->runEnd[merge->nruns - 1] = merge->nitems;
+}
+
+static inline int
+matchMergeCompare(RumMatchMerge *merge, int run1, int run2)
+{
+	return rumCompareItemPointers(&merge->items[merge->runPos[run1]].item.iptr,
+								  &merge->items[merge->runPos[run2]].item.iptr);
+}
+
+static void
+matchMergeSiftDown(RumMatchMerge *merge, int i)
+{
+	for (;;)
+	{
+		int			left = 2 * i + 1,
+					right = left + 1,
+					min = i,
+					tmp;
+
+		if (left < merge->nheap &&
+			matchMergeCompare(merge, merge->heap[left], merge->heap[min]) < 0)
+			min = left;
+		if (right < merge->nheap &&
+			matchMergeCompare(merge, merge->heap[right], merge->heap[min]) < 0)
+			min = right;
+		if (min == i)
+			break;
+
+		tmp = merge->heap[i];
+		merge->heap[i] = merge->heap[min];
+		merge->heap[min] = tmp;
+		i = min;
+	}
+}
+
+/*
+ * Prepare collected items to be returned by matchItemsNext().
+ */
+static void
+matchItemsDone(RumScanEntry entry)
+{
+	RumMatchMerge *merge = entry->matchMerge;
+	int			i;
+
+	if (merge == NULL)
+	{
+		rum_tuplesort_performsort(entry->matchSortstate);
+		return;
+	}
+
+	merge->nheap = merge->nruns;
+	for (i = 0; i < merge->nruns; i++)
+		merge->heap[i] = i;
+	for (i = merge->nheap / 2 - 1; i >= 0; i--)
+		matchMergeSiftDown(merge, i);
+}
+
+/*
+ * Returns next collected item in ascending order or NULL.
+ */
+static RumScanItem *
+matchItemsNext(RumScanEntry entry, bool *should_free)
+{
+	RumMatchMerge *merge = entry->matchMerge;
+	RumScanItem *item;
+	int			run;
+
+	if (merge == NULL)
+		return rum_tuplesort_getrumitem(entry->matchSortstate,
+				ScanDirectionIsForward(entry->scanDirection) ? true : false,
+										should_free);
+
+	*should_free = false;
+	if (merge->nheap == 0)
+		return NULL;
+
+	run = merge->heap[0];
+	item = &merge->items[merge->runPos[run]++];
+	if (merge->runPos[run] >= merge->runEnd[run])
+		merge->heap[0] = merge->heap[--merge->nheap];
+	if (merge->nheap > 0)
+		matchMergeSiftDown(merge, 0);
+
+	return item;
+}
+
+static void
+matchItemsEnd(RumScanEntry entry)
+{
+	if (entry->matchMerge)
+		rumFreeMatchMerge(entry);
+	else
+	{
+		rum_tuplesort_end(entry->matchSortstate);
+		entry->matchSortstate = NULL;
+	}
+}
+
 /*
  * Scan all pages of a posting tree and save all its heap ItemPointers
- * in scanEntry->matchSortstate
+ * using collectMatchItem()
  */
 static void
 scanPostingTree(Relation index, RumScanEntry scanEntry,
@@ -230,13 +405,14 @@ scanPostingTree(Relation index, RumScanEntry scanEntry,
 									ForwardScanDirection, attnum, rumstate);
 
 	buffer = rumScanBeginPostingTree(gdi, NULL);
+	rumPostingTreeStartPrefetch(gdi, ForwardScanDirection);
 
 	IncrBufferRefCount(buffer); /* prevent unpin in freeRumBtreeStack */
 
 	PredicateLockPage(index, BufferGetBlockNumber(buffer), snapshot);
 
 	freeRumBtreeStack(gdi->stack);
-	pfree(gdi);
+	gdi->stack = NULL;
 
 	/*
 	 * Loop iterates through all leaf pages of posting tree
@@ -264,7 +440,7 @@ scanPostingTree(Relation index, RumScanEntry scanEntry,
 				ptr = rumDataPageLeafRead(ptr, attnum, &item.item, false,
 										  rumstate);
 				SCAN_ITEM_PUT_KEY(scanEntry, item, idatum, icategory);
-				rum_tuplesort_putrumitem(scanEntry->matchSortstate, &item);
+				collectMatchItem(scanEntry, &item);
 			}
 
 			scanEntry->predictNumberResult += maxoff;
@@ -273,18 +449,24 @@ scanPostingTree(Relation index, RumScanEntry scanEntry,
 		if (RumPageRightMost(page))
 			break;				/* no more pages */
 
-		buffer = rumStep(buffer, index, RUM_SHARE, ForwardScanDirection);
+		buffer = rumStep(buffer, index, RUM_SHARE, ForwardScanDirection,
+						 gdi->strategy);
+		rumPostingTreeStepPrefetch(gdi, ForwardScanDirection);
 
 		PredicateLockPage(index, BufferGetBlockNumber(buffer), snapshot);
 
 	}
 
 	UnlockReleaseBuffer(buffer);
+	if (gdi->strategy)
+		FreeAccessStrategy(gdi->strategy);
+	pfree(gdi);
 }
 
 /*
- * Collects TIDs into scanEntry->matchSortstate for all heap tuples that
- * match the search entry.  This supports three different match modes:
+ * Collects TIDs into scanEntry->matchSortstate (or matchMerge) for all heap
+ * tuples that match the search entry.  This supports three different match
+ * modes:
  *
  * 1. Partial-match support: scan from current point until the
  *	  comparePartialFn says we're done.
@@ -310,8 +492,20 @@ collectMatchBitmap(RumBtreeData * btree, RumBtreeStack * stack,
 		cmp = &rumstate->compareFn[rumstate->attrnAttachColumn - 1];
 	}
 
-	/* Initialize  */
-	scanEntry->matchSortstate = rum_tuplesort_begin_rumitem(work_mem, cmp);
+	/*
+	 * Initialize.  Without custom compare function items are sorted in
+	 * ItemPointer order, which is the order of posting lists and trees, so
+	 * collect them for merge instead of sorting.
+	 */
+	if (cmp == NULL)
+	{
+		scanEntry->matchMerge = (RumMatchMerge *) palloc0(sizeof(RumMatchMerge));
+		scanEntry->matchMerge->maxitems = 256;
+		scanEntry->matchMerge->items = (RumScanItem *)
+			palloc(sizeof(RumScanItem) * scanEntry->matchMerge->maxitems);
+	}
+	else
+		scanEntry->matchSortstate = rum_tuplesort_begin_rumitem(work_mem, cmp);
 
 	/* Null query cannot partial-match anything */
 	if (scanEntry->isPartialMatch &&
@@ -475,7 +669,7 @@ collectMatchBitmap(RumBtreeData * btree, RumBtreeStack * stack,
 				ptr = rumDataPageLeafRead(ptr, scanEntry->attnum, &item.item,
 										  true, rumstate);
 				SCAN_ITEM_PUT_KEY(scanEntry, item, idatum, icategory);
-				rum_tuplesort_putrumitem(scanEntry->matchSortstate, &item);
+				collectMatchItem(scanEntry, &item);
 			}
 
 			scanEntry->predictNumberResult += RumGetNPosting(itup);
@@ -558,6 +752,7 @@ restartScanEntry:
 	entry->stack = NULL;
 	entry->nlist = 0;
 	entry->matchSortstate = NULL;
+	entry->matchMerge = NULL;
 	entry->reduceResult = false;
 	entry->predictNumberResult = 0;
 
@@ -596,19 +791,16 @@ restartScanEntry:
 			 * found data and rescan. See comments near 'return false' in
 			 * collectMatchBitmap()
 			 */
-			if (entry->matchSortstate)
-			{
-				rum_tuplesort_end(entry->matchSortstate);
-				entry->matchSortstate = NULL;
-			}
+			if (entry->matchSortstate || entry->matchMerge)
+				matchItemsEnd(entry);
 			LockBuffer(stackEntry->buffer, RUM_UNLOCK);
 			freeRumBtreeStack(stackEntry);
 			goto restartScanEntry;
 		}
 
-		if (entry->matchSortstate)
+		if (entry->matchSortstate || entry->matchMerge)
 		{
-			rum_tuplesort_performsort(entry->matchSortstate);
+			matchItemsDone(entry);
 			RumItemPointerSetMin(&entry->collectRumItem.item.iptr);
 			entry->isFinished = false;
 		}
@@ -633,8 +825,7 @@ restartScanEntry:
 		{
 			BlockNumber rootPostingTree = RumGetPostingTree(itup);
 			RumPostingTreeScan *gdi;
-			OffsetNumber maxoff,
-						i;
+			OffsetNumber maxoff;
 			Pointer		ptr;
 			RumItem		item;
 
@@ -654,6 +845,7 @@ restartScanEntry:
 
 			entry->buffer = rumScanBeginPostingTree(gdi, entry->useMarkAddInfo ?
 													&entry->markAddInfo : NULL);
+			rumPostingTreeStartPrefetch(gdi, entry->scanDirection);
 
 			entry->gdi = gdi;
 
@@ -675,13 +867,8 @@ restartScanEntry:
 			entry->nlist = maxoff;
 
 			ptr = RumDataPageGetData(page);
-
-			for (i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
-			{
-				ptr = rumDataPageLeafRead(ptr, entry->attnum, &item, true,
-										  rumstate);
-				entry->list[i - FirstOffsetNumber] = item;
-			}
+			rumDataPageLeafReadItems(ptr, entry->attnum, &item.iptr,
+									 entry->list, maxoff, true, rumstate);
 
 			LockBuffer(entry->buffer, RUM_UNLOCK);
 			entry->isFinished = setListPositionScanEntry(rumstate, entry);
@@ -790,6 +977,17 @@ isScanWithAltOrderKeys(RumScanOpaque so)
 	return (withUsualKeys && withAltKeys);
 }
 
+/*
+ * The first key of a full-index scan reads all the entries ordered by
+ * additional information.
+ */
+static bool
+isFullScan(RumScanOpaque so)
+{
+	return so->nkeys > 0 && so->keys[0]->nentries > 0 &&
+		so->keys[0]->scanEntry[0]->scanWithAddInfo;
+}
+
 static void
 startScan(IndexScanDesc scan)
 {
@@ -859,7 +1057,7 @@ startScan(IndexScanDesc scan)
 		RumScanKey	key = so->keys[i];
 
 		/* Check first key is it used to full-index scan */
-		if (i == 0 && key->nentries > 0 && key->scanEntry[i]->scanWithAddInfo)
+		if (i == 0 && isFullScan(so))
 		{
 			scanType = RumFullScan;
 			break;
@@ -973,9 +1171,11 @@ entryGetNextItem(RumState * rumstate, RumScanEntry entry, Snapshot snapshot)
 			}
 
 			entry->buffer = rumStep(entry->buffer, rumstate->index,
-									RUM_SHARE, entry->scanDirection);
+									RUM_SHARE, entry->scanDirection,
+									entry->gdi->strategy);
 			entry->gdi->stack->buffer = entry->buffer;
 			entry->gdi->stack->blkno = BufferGetBlockNumber(entry->buffer);
+			rumPostingTreeStepPrefetch(entry->gdi, entry->scanDirection);
 			page = BufferGetPage(entry->buffer);
 
 			PredicateLockPage(rumstate->index, BufferGetBlockNumber(entry->buffer), snapshot);
@@ -985,27 +1185,23 @@ entryGetNextItem(RumState * rumstate, RumScanEntry entry, Snapshot snapshot)
 			entry->nlist = maxoff;
 			RumItemPointerSetMin(&item.iptr);
 			ptr = RumDataPageGetData(page);
+			rumDataPageLeafReadItems(ptr, entry->attnum, &item.iptr,
+									 entry->list, maxoff, true, rumstate);
 
-			for (i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+			for (i = FirstOffsetNumber; searchBorder && i <= maxoff;
+				 i = OffsetNumberNext(i))
 			{
-				ptr = rumDataPageLeafRead(ptr, entry->attnum, &item, true,
-										  rumstate);
-				entry->list[i - FirstOffsetNumber] = item;
-
-				if (searchBorder)
+				/* don't search position for backward scan,
+				   because of split algorithm */
+				int cmp = compareRumItem(rumstate,
+										 entry->attnumOrig,
+										 &entry->curItem,
+										 &entry->list[i - FirstOffsetNumber]);
+
+				if (cmp > 0)
 				{
-					/* don't search position for backward scan,
-					   because of split algorithm */
-					int cmp = compareRumItem(rumstate,
-											 entry->attnumOrig,
-											 &entry->curItem,
-											 &item);
-
-					if (cmp > 0)
-					{
-						entry->offset = i - FirstOffsetNumber;
-						searchBorder = false;
-					}
+					entry->offset = i - FirstOffsetNumber;
+					searchBorder = false;
 				}
 			}
 
@@ -1047,6 +1243,8 @@ entryGetNextItemList(RumState * rumstate, RumScanEntry entry, Snapshot snapshot)
 	if (entry->gdi)
 	{
 		freeRumBtreeStack(entry->gdi->stack);
+		if (entry->gdi->strategy)
+			FreeAccessStrategy(entry->gdi->strategy);
 		pfree(entry->gdi);
 	}
 	entry->gdi = NULL;
@@ -1057,6 +1255,7 @@ entryGetNextItemList(RumState * rumstate, RumScanEntry entry, Snapshot snapshot)
 		entry->nlist = 0;
 	}
 	entry->matchSortstate = NULL;
+	entry->matchMerge = NULL;
 	entry->reduceResult = false;
 	entry->predictNumberResult = 0;
 
@@ -1099,8 +1298,7 @@ entryGetNextItemList(RumState * rumstate, RumScanEntry entry, Snapshot snapshot)
 	{
 		BlockNumber rootPostingTree = RumGetPostingTree(itup);
 		RumPostingTreeScan *gdi;
-		OffsetNumber maxoff,
-					i;
+		OffsetNumber maxoff;
 		Pointer		ptr;
 		RumItem		item;
 
@@ -1120,6 +1318,7 @@ entryGetNextItemList(RumState * rumstate, RumScanEntry entry, Snapshot snapshot)
 						entry->attnumOrig, rumstate);
 
 		entry->buffer = rumScanBeginPostingTree(gdi, NULL);
+		rumPostingTreeStartPrefetch(gdi, entry->scanDirection);
 		entry->gdi = gdi;
 
 		PredicateLockPage(rumstate->index, BufferGetBlockNumber(entry->buffer), snapshot);
@@ -1141,13 +1340,8 @@ entryGetNextItemList(RumState * rumstate, RumScanEntry entry, Snapshot snapshot)
 		entry->nlist = maxoff;
 
 		ptr = RumDataPageGetData(page);
-
-		for (i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
-		{
-			ptr = rumDataPageLeafRead(ptr, entry->attnum, &item, true,
-									  rumstate);
-			entry->list[i - FirstOffsetNumber] = item;
-		}
+		rumDataPageLeafReadItems(ptr, entry->attnum, &item.iptr,
+								 entry->list, maxoff, true, rumstate);
 
 		LockBuffer(entry->buffer, RUM_UNLOCK);
 		entry->isFinished = false;
@@ -1202,7 +1396,7 @@ entryGetItem(RumState * rumstate, RumScanEntry entry, bool *nextEntryList, Snaps
 	if (nextEntryList)
 		*nextEntryList = false;
 
-	if (entry->matchSortstate)
+	if (entry->matchSortstate || entry->matchMerge)
 	{
 		Assert(ScanDirectionIsForward(entry->scanDirection));
 
@@ -1215,8 +1409,7 @@ entryGetItem(RumState * rumstate, RumScanEntry entry, bool *nextEntryList, Snaps
 			if (RumItemPointerIsMax(&entry->collectRumItem.item.iptr))
 			{
 				entry->isFinished = true;
-				rum_tuplesort_end(entry->matchSortstate);
-				entry->matchSortstate = NULL;
+				matchItemsEnd(entry);
 				break;
 			}
 
@@ -1232,10 +1425,7 @@ entryGetItem(RumState * rumstate, RumScanEntry entry, bool *nextEntryList, Snaps
 			{
 				bool	should_free;
 
-				current_collected = rum_tuplesort_getrumitem(
-					entry->matchSortstate,
-					ScanDirectionIsForward(entry->scanDirection) ? true : false,
-					&should_free);
+				current_collected = matchItemsNext(entry, &should_free);
 
 				if (current_collected == NULL)
 				{
@@ -1324,8 +1514,7 @@ entryGetItem(RumState * rumstate, RumScanEntry entry, bool *nextEntryList, Snaps
 				if (RumItemPointerIsMin(&entry->curItem.iptr))
 				{
 					entry->isFinished = true;
-					rum_tuplesort_end(entry->matchSortstate);
-					entry->matchSortstate = NULL;
+					matchItemsEnd(entry);
 					break;
 				}
 			}
@@ -1498,16 +1687,25 @@ keyGetItem(RumState * rumstate, MemoryContext tempCtx, RumScanKey key)
 }
 
 /*
- * The function puts all the suitable tids for
- * the passed RumScanKey into the RumTIDBitmap.
+ * The function collects all the suitable tids for the passed RumScanKey.
+ * While they fit in work_mem, they are stored exactly in *tids array,
+ * allocated in keyCtx and sorted in ascending order.  Otherwise they are put
+ * into newly created *tbm, which may become lossy.
  */
 static void
-collectAllCurItemsToBitmap(RumScanKey key, RumTIDBitmap *tbm,
-						   IndexScanDesc scan)
+collectAllCurItems(RumScanKey key, IndexScanDesc scan,
+				   ItemPointerData **tids, int *ntids, RumTIDBitmap **tbm)
 {
 	RumScanOpaque		so = (RumScanOpaque) scan->opaque;
 	RumState			*rumstate = &so->rumstate;
 	ItemPointerData		advancePast;
+	long				maxbytes = work_mem * 1024L;
+	Size				maxarray = Min((Size) maxbytes, MaxAllocSize);
+	int					maxtids = 0;
+
+	*tids = NULL;
+	*ntids = 0;
+	*tbm = NULL;
 
 	ItemPointerSetInvalid(&advancePast);
 
@@ -1544,14 +1742,109 @@ collectAllCurItemsToBitmap(RumScanKey key, RumTIDBitmap *tbm,
 		keyGetItem(rumstate, so->tempCtx, key);
 
 		if (key->isFinished)
-			return;
+			break;
 
-		/* If curItem is suitable, put it in the RumTIDBitmap */
+		/* If curItem is suitable, save it */
 		if (key->curItemMatches)
-			rum_tbm_add_tuples(tbm, &key->curItem.iptr, 1, false);
+		{
+			if (*tbm == NULL && *ntids >= maxtids)
+			{
+				int			newmax = Max(maxtids * 2, 1024);
+
+				if ((Size) newmax * sizeof(ItemPointerData) <= maxarray)
+				{
+					maxtids = newmax;
+					if (*tids)
+						*tids = (ItemPointerData *)
+							repalloc(*tids, sizeof(ItemPointerData) * maxtids);
+					else
+						*tids = (ItemPointerData *)
+							MemoryContextAlloc(so->keyCtx,
+											   sizeof(ItemPointerData) * maxtids);
+				}
+				else
+				{
+					/* Doesn't fit, switch to the bitmap */
+					*tbm = rum_tbm_create(maxbytes, NULL);
+					rum_tbm_add_tuples(*tbm, *tids, *ntids, false);
+					pfree(*tids);
+					*tids = NULL;
+					*ntids = 0;
+				}
+			}
+
+			if (*tbm)
+				rum_tbm_add_tuples(*tbm, &key->curItem.iptr, 1, false);
+			else
+				(*tids)[(*ntids)++] = key->curItem.iptr;
+		}
 
 		advancePast = key->curItem.iptr;
 	}
+
+	/* Items of backward scan come in descending order */
+	if (*ntids > 1 &&
+		rumCompareItemPointers(&(*tids)[0], &(*tids)[*ntids - 1]) > 0)
+	{
+		for (int i = 0; i < *ntids / 2; i++)
+		{
+			ItemPointerData tmp = (*tids)[i];
+
+			(*tids)[i] = (*tids)[*ntids - 1 - i];
+			(*tids)[*ntids - 1 - i] = tmp;
+		}
+	}
+}
+
+/*
+ * Intersect two sorted arrays of tids, the result is stored in a.
+ */
+static int
+intersectTids(ItemPointerData *a, int na, ItemPointerData *b, int nb)
+{
+	int			i = 0,
+				j = 0,
+				n = 0;
+
+	while (i < na && j < nb)
+	{
+		int			cmp = rumCompareItemPointers(&a[i], &b[j]);
+
+		if (cmp < 0)
+			i++;
+		else if (cmp > 0)
+			j++;
+		else
+		{
+			a[n++] = a[i];
+			i++;
+			j++;
+		}
+	}
+
+	return n;
+}
+
+static bool
+tidsContain(ItemPointerData *tids, int ntids, ItemPointer tid)
+{
+	int			low = 0,
+				high = ntids;
+
+	while (high > low)
+	{
+		int			mid = low + (high - low) / 2;
+		int			cmp = rumCompareItemPointers(&tids[mid], tid);
+
+		if (cmp == 0)
+			return true;
+		else if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return false;
 }
 
 /*
@@ -1580,7 +1873,6 @@ scanGetItemRegular(IndexScanDesc scan, RumItem *advancePast,
 	bool		match, itemSet;
 
 	RumTIDBitmap *cur_key_tbm = NULL;
-	bool		soBitmapSet = false;
 	bool		bitmapRecheck = false;
 
 	/*
@@ -1590,29 +1882,70 @@ scanGetItemRegular(IndexScanDesc scan, RumItem *advancePast,
 	if (so->scanWithAltOrderKeys &&
 		ItemPointerIsValid(&advancePast->iptr) == false)
 	{
-		/* For each key, put all the appropriate tids into the bitmap */
+		bool		firstKey = true;
+
+		so->useAltOrderTids = true;
+
+		/* For each key, collect all the appropriate tids */
 		for (int i = 0; i < so->nkeys; i++)
 		{
+			ItemPointerData *tids;
+			int			ntids;
+
 			if (so->keys[i]->orderBy ||
 				rumstate->attrnAddToColumn == so->keys[i]->attnumOrig)
 				continue;
 
-			cur_key_tbm = rum_tbm_create(work_mem * 1024L, NULL);
-			collectAllCurItemsToBitmap(so->keys[i], cur_key_tbm, scan);
+			collectAllCurItems(so->keys[i], scan, &tids, &ntids, &cur_key_tbm);
 
 			/*
-			 * so->tbm contains matching tids for
-			 * all keys that are ordered by tid.
+			 * so->altOrderTids (or so->tbm once some key didn't fit in
+			 * work_mem) contains matching tids for all keys that are ordered
+			 * by tid.
 			 */
-			if (soBitmapSet == false)
+			if (so->useAltOrderTids && cur_key_tbm)
+			{
+				so->useAltOrderTids = false;
+				if (!firstKey)
+					rum_tbm_add_tuples(so->tbm, so->altOrderTids,
+									   so->nAltOrderTids, false);
+				if (so->altOrderTids)
+					pfree(so->altOrderTids);
+				so->altOrderTids = NULL;
+				so->nAltOrderTids = 0;
+			}
+			else if (!so->useAltOrderTids && cur_key_tbm == NULL)
 			{
-				soBitmapSet = true;
-				rum_tbm_union(so->tbm, cur_key_tbm);
+				cur_key_tbm = rum_tbm_create(work_mem * 1024L, NULL);
+				rum_tbm_add_tuples(cur_key_tbm, tids, ntids, false);
+			}
+
+			if (so->useAltOrderTids)
+			{
+				if (firstKey)
+				{
+					so->altOrderTids = tids;
+					so->nAltOrderTids = ntids;
+					tids = NULL;
+				}
+				else
+					so->nAltOrderTids = intersectTids(so->altOrderTids,
+													  so->nAltOrderTids,
+													  tids, ntids);
 			}
 			else
-				rum_tbm_intersect(so->tbm, cur_key_tbm);
+			{
+				if (firstKey)
+					rum_tbm_union(so->tbm, cur_key_tbm);
+				else
+					rum_tbm_intersect(so->tbm, cur_key_tbm);
 
-			rum_tbm_free(cur_key_tbm);
+				rum_tbm_free(cur_key_tbm);
+			}
+
+			if (tids)
+				pfree(tids);
+			firstKey = false;
 		}
 	}
 
@@ -1739,7 +2072,14 @@ scanGetItemRegular(IndexScanDesc scan, RumItem *advancePast,
 		 * you may need to recheck the *item.
 		 */
 		if (so->scanWithAltOrderKeys && match)
-			match = rum_tbm_contains_tid(so->tbm, &item->iptr, &bitmapRecheck);
+		{
+			if (so->useAltOrderTids)
+				match = tidsContain(so->altOrderTids, so->nAltOrderTids,
+									&item->iptr);
+			else
+				match = rum_tbm_contains_tid(so->tbm, &item->iptr,
+											 &bitmapRecheck);
+		}
 
 		if (match)
 			break;
@@ -1797,7 +2137,8 @@ scanGetItemRegular(IndexScanDesc scan, RumItem *advancePast,
 static bool
 scanPage(RumState * rumstate, RumScanEntry entry, RumItem *item, bool equalOk)
 {
-	int			j;
+	int			j,
+				nentries;
 	RumItem		iter_item;
 	Pointer		ptr;
 	OffsetNumber first = FirstOffsetNumber,
@@ -1821,40 +2162,25 @@ scanPage(RumState * rumstate, RumScanEntry entry, RumItem *item, bool equalOk)
 	ptr = RumDataPageGetData(page);
 	maxoff = RumPageGetOpaque(page)->maxoff;
 
-	for (j = 0; j < RumDataLeafIndexCount; j++)
+	j = rumDataLeafIndexSearch(rumstate, entry->attnumOrig, page, item,
+							   equalOk, &nentries);
+	if (j > 0)
 	{
-		RumDataLeafItemIndex *index = &RumPageGetIndexes(page)[j];
-
-		if (index->offsetNumer == InvalidOffsetNumber)
-			break;
+		RumDataLeafItemIndex *index = &RumPageGetIndexes(page)[j - 1];
 
-		if (rumstate->useAlternativeOrder)
-		{
-			RumItem		k;
-
-			convertIndexToKey(index, &k);
-			cmp = compareRumItem(rumstate, entry->attnumOrig, &k, item);
-		}
-		else
-			cmp = rumCompareItemPointers(&index->iptr, &item->iptr);
-
-		if (cmp < 0 || (cmp <= 0 && !equalOk))
+		ptr = RumDataPageGetData(page) + index->pageOffset;
+		first = index->offsetNumer;
+		iter_item.iptr = index->iptr;
+	}
+	if (j < nentries)
+	{
+		if (ScanDirectionIsBackward(entry->scanDirection))
 		{
-			ptr = RumDataPageGetData(page) + index->pageOffset;
-			first = index->offsetNumer;
-			iter_item.iptr = index->iptr;
+			if (j + 1 < RumDataLeafIndexCount)
+				maxoff = RumPageGetIndexes(page)[j+1].offsetNumer;
 		}
 		else
-		{
-			if (ScanDirectionIsBackward(entry->scanDirection))
-			{
-				if (j + 1 < RumDataLeafIndexCount)
-					maxoff = RumPageGetIndexes(page)[j+1].offsetNumer;
-			}
-			else
-				maxoff = index->offsetNumer - 1;
-			break;
-		}
+			maxoff = RumPageGetIndexes(page)[j].offsetNumer - 1;
 	}
 
 	if (ScanDirectionIsBackward(entry->scanDirection) && first >= maxoff)
@@ -1865,24 +2191,21 @@ scanPage(RumState * rumstate, RumScanEntry entry, RumItem *item, bool equalOk)
 	}
 
 	entry->nlist = maxoff - first + 1;
+	rumDataPageLeafReadItems(ptr, entry->attnum, &iter_item.iptr,
+							 entry->list, entry->nlist, true, rumstate);
+
 	bound = -1;
 	for (i = first; i <= maxoff; i++)
 	{
-		ptr = rumDataPageLeafRead(ptr, entry->attnum, &iter_item, true,
-								  rumstate);
-		entry->list[i - first] = iter_item;
-
-		if (bound != -1)
-			continue;
-
 		cmp = compareRumItem(rumstate, entry->attnumOrig,
-							 item, &iter_item);
+							 item, &entry->list[i - first]);
 
 		if (cmp <= 0)
 		{
 			bound = i - first;
 			if (cmp == 0)
 				found_eq = true;
+			break;
 		}
 	}
 
@@ -1986,6 +2309,7 @@ entryFindItem(RumState * rumstate, RumScanEntry entry, RumItem * item, Snapshot
 	entry->gdi->stack->buffer = entry->buffer;
 	entry->gdi->stack = rumReFindLeafPage(&entry->gdi->btree, entry->gdi->stack);
 	entry->buffer = entry->gdi->stack->buffer;
+	rumPostingTreeStartPrefetch(entry->gdi, entry->scanDirection);
 
 	PredicateLockPage(rumstate->index, BufferGetBlockNumber(entry->buffer), snapshot);
 
@@ -1999,7 +2323,8 @@ entryFindItem(RumState * rumstate, RumScanEntry entry, RumItem * item, Snapshot
 	for (;;)
 	{
 		entry->buffer = rumStep(entry->buffer, rumstate->index,
-								RUM_SHARE, entry->scanDirection);
+								RUM_SHARE, entry->scanDirection,
+								entry->gdi->strategy);
 		entry->gdi->stack->buffer = entry->buffer;
 
 		if (entry->buffer == InvalidBuffer)
@@ -2012,6 +2337,7 @@ entryFindItem(RumState * rumstate, RumScanEntry entry, RumItem * item, Snapshot
 		PredicateLockPage(rumstate->index, BufferGetBlockNumber(entry->buffer), snapshot);
 
 		entry->gdi->stack->blkno = BufferGetBlockNumber(entry->buffer);
+		rumPostingTreeStepPrefetch(entry->gdi, entry->scanDirection);
 
 		if (scanPage(rumstate, entry, item, true))
 		{
@@ -2083,9 +2409,12 @@ static void
 entryShift(int i, RumScanOpaque so, bool find, Snapshot snapshot)
 {
 	int			minIndex = -1,
-				j;
+				j,
+				low,
+				high;
 	uint32		minPredictNumberResult = 0;
 	RumState   *rumstate = &so->rumstate;
+	RumScanEntry shifted;
 
 	/*
 	 * It's more efficient to move entry with smallest posting list/tree. So
@@ -2108,17 +2437,31 @@ entryShift(int i, RumScanOpaque so, bool find, Snapshot snapshot)
 	else if (!so->sortedEntries[minIndex]->isFinished)
 		entryGetItem(rumstate, so->sortedEntries[minIndex], NULL, snapshot);
 
-	/* Restore order of so->sortedEntries */
-	while (minIndex > 0 &&
-		   cmpEntries(rumstate, so->sortedEntries[minIndex],
-					  so->sortedEntries[minIndex - 1]) > 0)
+	/*
+	 * Restore order of so->sortedEntries.  The shifted entry could only move
+	 * towards the beginning of the array, which is still ordered before it.
+	 * So find its new place by binary search and move the entries in between
+	 * at once, instead of bubbling it one position at a time: this keeps the
+	 * number of compareRumItem() calls logarithmic in the number of entries.
+	 */
+	shifted = so->sortedEntries[minIndex];
+	low = 0;
+	high = minIndex;
+	while (high > low)
 	{
-		RumScanEntry tmp;
+		int			mid = low + (high - low) / 2;
+
+		if (cmpEntries(rumstate, shifted, so->sortedEntries[mid]) > 0)
+			high = mid;
+		else
+			low = mid + 1;
+	}
 
-		tmp = so->sortedEntries[minIndex];
-		so->sortedEntries[minIndex] = so->sortedEntries[minIndex - 1];
-		so->sortedEntries[minIndex - 1] = tmp;
-		minIndex--;
+	if (low < minIndex)
+	{
+		memmove(so->sortedEntries + low + 1, so->sortedEntries + low,
+				sizeof(RumScanEntry) * (minIndex - low));
+		so->sortedEntries[low] = shifted;
 	}
 }
 
@@ -2331,6 +2674,144 @@ scanGetItem(IndexScanDesc scan, RumItem *advancePast,
 		return scanGetItemRegular(scan, advancePast, item, recheck);
 }
 
+/*
+ * Moves the scan forward, so that the next scanGetItem() call with so->item
+ * as advancePast returns an item greater than the target.  Used to skip
+ * chunks which belong to other participants of a parallel scan.
+ */
+static void
+scanSeekItem(IndexScanDesc scan, RumItem *target)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+	uint32		i;
+
+	/* Regular scan advances its entries past advancePast by itself */
+	if (so->scanType == RumFastScan)
+	{
+		for (i = 0; i < so->totalentries; i++)
+		{
+			RumScanEntry entry = so->sortedEntries[i];
+
+			if (entry->isFinished == false &&
+				compareRumItem(&so->rumstate, entry->attnumOrig,
+							   &entry->curItem, target) <= 0)
+				entryFindItem(&so->rumstate, entry, target, scan->xs_snapshot);
+		}
+
+		qsort_arg(so->sortedEntries, so->totalentries, sizeof(RumScanEntry),
+				  scan_entry_cmp, &so->rumstate);
+		so->entriesIncrIndex = -1;
+	}
+
+	so->item = *target;
+}
+
+#if PG_VERSION_NUM >= 100000
+/*
+ * Takes the whole scan for this participant.  Returns false if it's already
+ * taken by another one.
+ */
+static bool
+rumParallelClaimScan(IndexScanDesc scan)
+{
+	RumParallelScanDesc pscan = RumGetParallelScanDesc(scan);
+	bool		claimed;
+
+	SpinLockAcquire(&pscan->mutex);
+	claimed = !pscan->scanClaimed;
+	pscan->scanClaimed = true;
+	SpinLockRelease(&pscan->mutex);
+
+	return claimed;
+}
+
+/*
+ * Claims a chunk of heap blocks.  itemChunk is the chunk of the item we stand
+ * at.  Chunks between the previously claimed one and itemChunk don't contain
+ * any items, since we have just scanned through them, so itemChunk could be
+ * taken if nobody took it yet.
+ */
+static BlockNumber
+rumParallelClaimChunk(IndexScanDesc scan, BlockNumber itemChunk)
+{
+	RumParallelScanDesc pscan = RumGetParallelScanDesc(scan);
+	BlockNumber chunk;
+
+	SpinLockAcquire(&pscan->mutex);
+	chunk = Max(pscan->nextChunk, itemChunk);
+	pscan->nextChunk = chunk + 1;
+	SpinLockRelease(&pscan->mutex);
+
+	return chunk;
+}
+
+/*
+ * Get next item of a parallel scan.  Every participant runs the same scan,
+ * but returns only items of the chunks claimed by it.  Chunks are claimed in
+ * increasing order, so the scan is only moved forward.
+ */
+static bool
+scanGetItemParallel(IndexScanDesc scan, bool *recheck)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+	RumParallelScanDesc pscan = RumGetParallelScanDesc(scan);
+
+	for (;;)
+	{
+		BlockNumber itemChunk;
+
+		if (!so->hasNextItem)
+		{
+			if (!scanGetItem(scan, &so->item, &so->item, &so->nextItemRecheck))
+				return false;
+			so->hasNextItem = true;
+		}
+
+		itemChunk = RumItemPointerGetBlockNumber(&so->item.iptr) /
+			pscan->chunkBlocks;
+
+		if (itemChunk == so->curChunk)
+		{
+			so->hasNextItem = false;
+			*recheck = so->nextItemRecheck;
+			return true;
+		}
+
+		Assert(so->curChunk == InvalidBlockNumber || itemChunk > so->curChunk);
+		so->curChunk = rumParallelClaimChunk(scan, itemChunk);
+
+		if (so->curChunk != itemChunk)
+		{
+			RumItem		target;
+
+			/* Skip to the end of the previous chunk */
+			Assert(so->curChunk > itemChunk);
+			ItemPointerSet(&target.iptr,
+						   so->curChunk * pscan->chunkBlocks - 1,
+						   MaxOffsetNumber);
+			target.addInfoIsNull = true;
+			target.addInfo = (Datum) 0;
+
+			scanSeekItem(scan, &target);
+			so->hasNextItem = false;
+		}
+	}
+}
+#endif
+
+static bool
+scanGetNextItem(IndexScanDesc scan, bool *recheck)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+
+#if PG_VERSION_NUM >= 100000
+	if (so->parallelChunks)
+		return scanGetItemParallel(scan, recheck);
+#endif
+
+	return scanGetItem(scan, &so->item, &so->item, recheck);
+}
+
 #define RumIsNewKey(s)		( ((RumScanOpaque) scan->opaque)->keys == NULL )
 #define RumIsVoidRes(s)		( ((RumScanOpaque) scan->opaque)->isVoidRes )
 
@@ -2355,6 +2836,11 @@ rumgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 
 	so->entriesIncrIndex = -1;
 
+#ifdef RUM_INSERT_BUFFER
+	/* The scan must see the entries buffered by this backend */
+	rumFlushPendingInserts(scan->indexRelation);
+#endif
+
 	/*
 	 * Now scan the main index.
 	 */
@@ -2447,6 +2933,231 @@ keyGetOrdering(RumState * rumstate, MemoryContext tempCtx, RumScanKey key,
 											 ));
 }
 
+/*
+ * Bounded top-K collection of ordered results.
+ *
+ * When rum.sort_limit is set, the collect-and-sort path of rumgettuple()
+ * keeps only the best sortBound items in a max-heap instead of feeding every
+ * matching item to the tuplesort.  Items are compared by their ordering
+ * values and then by item pointer, so the heap contents are exactly the first
+ * sortBound items of a full sort with compareItemPointer = true.
+ */
+static int
+compareSortItems(const RumSortItem *a, const RumSortItem *b, int nKeys)
+{
+	int			i;
+
+	for (i = 0; i < nKeys; i++)
+	{
+		if (a->data[i] < b->data[i])
+			return -1;
+		else if (a->data[i] > b->data[i])
+			return 1;
+	}
+
+	return rumCompareItemPointers(&a->iptr, &b->iptr);
+}
+
+static int
+compareSortItemsQsort(const void *a, const void *b, void *arg)
+{
+	return compareSortItems(*(RumSortItem *const *) a,
+							*(RumSortItem *const *) b,
+							*(int *) arg);
+}
+
+static int
+compareItemPointersQsort(const void *a, const void *b)
+{
+	return rumCompareItemPointers((const ItemPointerData *) a,
+								  (const ItemPointerData *) b);
+}
+
+/*
+ * Prepare a bounded heap for the current scan.  Returns false if bounded mode
+ * is disabled or the heap wouldn't fit into work_mem, in which case the
+ * caller should use the regular tuplesort.
+ */
+static bool
+topKBegin(RumScanOpaque so)
+{
+	Size		itemSize = MAXALIGN(RumSortItemSize(so->norderbys));
+	char	   *items;
+	int			i;
+
+	if (RumSortLimit <= 0 ||
+		(Size) RumSortLimit + 1 > (Size) work_mem * 1024L / itemSize)
+		return false;
+
+	so->sortBound = RumSortLimit;
+	so->nTopKItems = 0;
+	so->curTopKItem = 0;
+	so->topKOverflow = false;
+
+	/* one more slot is used to build the next candidate */
+	so->topKItems = (RumSortItem **)
+		MemoryContextAlloc(so->keyCtx,
+						   sizeof(RumSortItem *) * (so->sortBound + 1));
+	items = (char *) MemoryContextAlloc(so->keyCtx,
+										itemSize * (so->sortBound + 1));
+	for (i = 0; i <= so->sortBound; i++)
+		so->topKItems[i] = (RumSortItem *) (items + itemSize * i);
+
+	return true;
+}
+
+static void
+topKInsert(RumScanOpaque so, RumSortItem *item)
+{
+	RumSortItem **heap = so->topKItems;
+	int			i;
+
+	Assert(item == heap[so->sortBound]);
+
+	if (so->nTopKItems < so->sortBound)
+	{
+		/* heap isn't full yet, sift the new item up */
+		i = so->nTopKItems++;
+		heap[so->sortBound] = heap[i];
+
+		while (i > 0)
+		{
+			int			parent = (i - 1) / 2;
+
+			if (compareSortItems(heap[parent], item, so->norderbys) >= 0)
+				break;
+			heap[i] = heap[parent];
+			i = parent;
+		}
+		heap[i] = item;
+		return;
+	}
+
+	so->topKOverflow = true;
+
+	/* throw the item away if it isn't better than the worst one we have */
+	if (compareSortItems(item, heap[0], so->norderbys) >= 0)
+		return;
+
+	/* replace the root and sift it down */
+	heap[so->sortBound] = heap[0];
+	i = 0;
+	for (;;)
+	{
+		int			child = 2 * i + 1;
+
+		if (child >= so->nTopKItems)
+			break;
+		if (child + 1 < so->nTopKItems &&
+			compareSortItems(heap[child + 1], heap[child], so->norderbys) > 0)
+			child++;
+		if (compareSortItems(item, heap[child], so->norderbys) >= 0)
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = item;
+}
+
+static void
+topKFinish(RumScanOpaque so)
+{
+	qsort_arg(so->topKItems, so->nTopKItems, sizeof(RumSortItem *),
+			  compareSortItemsQsort, &so->norderbys);
+	so->curTopKItem = 0;
+}
+
+static void
+collectSortItems(IndexScanDesc scan, bool allowBound)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+	bool		recheck;
+
+	if (!allowBound || !topKBegin(so))
+		so->sortstate = rum_tuplesort_begin_rum(work_mem, so->norderbys,
+							false, so->scanType == RumFullScan);
+
+	while (scanGetNextItem(scan, &recheck))
+	{
+		insertScanItem(so, recheck);
+	}
+
+	if (so->topKItems)
+		topKFinish(so);
+	else
+		rum_tuplesort_performsort(so->sortstate);
+}
+
+/*
+ * The consumer wants more rows than the bounded heap kept.  Restart the scan
+ * and sort all matching items, skipping the ones which are already returned.
+ */
+static void
+topKRestart(IndexScanDesc scan)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+	ItemPointerData *returned;
+	int			nreturned = so->nTopKItems;
+	int			i;
+
+	returned = (ItemPointerData *) palloc(sizeof(ItemPointerData) * nreturned);
+	for (i = 0; i < nreturned; i++)
+		returned[i] = so->topKItems[i]->iptr;
+	qsort(returned, nreturned, sizeof(ItemPointerData),
+		  compareItemPointersQsort);
+
+	freeScanKeys(so);
+	if (so->tbm)
+	{
+		rum_tbm_free(so->tbm);
+		so->tbm = NULL;
+	}
+	rumNewScanKey(scan);
+
+	so->returnedItems = (ItemPointerData *)
+		MemoryContextAlloc(so->keyCtx, sizeof(ItemPointerData) * nreturned);
+	memcpy(so->returnedItems, returned, sizeof(ItemPointerData) * nreturned);
+	so->nReturnedItems = nreturned;
+	pfree(returned);
+
+	startScan(scan);
+	collectSortItems(scan, false);
+}
+
+/*
+ * Returns the next item of the collect-and-sort scan.
+ */
+static RumSortItem *
+getNextSortItem(IndexScanDesc scan, bool *should_free)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+	RumSortItem *item;
+
+	if (so->topKItems)
+	{
+		*should_free = false;
+		if (so->curTopKItem < so->nTopKItems)
+			return so->topKItems[so->curTopKItem++];
+		if (!so->topKOverflow)
+			return NULL;
+
+		topKRestart(scan);
+	}
+
+	for (;;)
+	{
+		item = rum_tuplesort_getrum(so->sortstate, true, should_free);
+
+		if (item == NULL || so->returnedItems == NULL ||
+			bsearch(&item->iptr, so->returnedItems, so->nReturnedItems,
+					sizeof(ItemPointerData), compareItemPointersQsort) == NULL)
+			return item;
+
+		if (*should_free)
+			pfree(item);
+	}
+}
+
 static void
 insertScanItem(RumScanOpaque so, bool recheck)
 {
@@ -2454,9 +3165,16 @@ insertScanItem(RumScanOpaque so, bool recheck)
 	uint32		i,
 				j;
 
-	item = (RumSortItem *)
-		MemoryContextAllocZero(rum_tuplesort_get_memorycontext(so->sortstate),
-							   RumSortItemSize(so->norderbys));
+	if (so->topKItems)
+	{
+		/* spare slot right after the heap */
+		item = so->topKItems[so->sortBound];
+		memset(item, 0, RumSortItemSize(so->norderbys));
+	}
+	else
+		item = (RumSortItem *)
+			MemoryContextAllocZero(rum_tuplesort_get_memorycontext(so->sortstate),
+								   RumSortItemSize(so->norderbys));
 	item->iptr = so->item.iptr;
 	item->recheck = recheck;
 
@@ -2529,7 +3247,11 @@ insertScanItem(RumScanOpaque so, bool recheck)
 
 		j++;
 	}
-	rum_tuplesort_putrum(so->sortstate, item);
+
+	if (so->topKItems)
+		topKInsert(so, item);
+	else
+		rum_tuplesort_putrum(so->sortstate, item);
 }
 
 static void
@@ -2558,6 +3280,131 @@ reverseScan(IndexScanDesc scan)
 	startScan(scan);
 }
 
+/*
+ * Returns the next item of the natural order scan.  When the scan is
+ * finished in the first direction, it is continued in the reverse one.
+ */
+static bool
+scanGetNaturalItem(IndexScanDesc scan, bool *recheck)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+
+	for (;;)
+	{
+		if (scanGetItem(scan, &so->item, &so->item, recheck))
+			return true;
+		if (so->secondPass)
+			return false;
+
+		reverseScan(scan);
+		so->secondPass = true;
+	}
+}
+
+/*
+ * Fill the look-ahead ring up to rum.heap_prefetch_distance items and
+ * prefetch their heap blocks, so that the heap fetches of the executor
+ * don't wait for the random reads one by one.
+ */
+static void
+prefetchScanItems(IndexScanDesc scan)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+
+	while (!so->prefetchFinished && so->nPrefetchItems < so->prefetchDistance)
+	{
+		RumSortItem *slot;
+		BlockNumber blkno;
+
+		slot = so->prefetchItems[(so->prefetchHead + so->nPrefetchItems) %
+								 so->prefetchDistance];
+
+		if (so->naturalOrder != NoMovementScanDirection)
+		{
+			bool		recheck;
+
+			if (!scanGetNaturalItem(scan, &recheck))
+			{
+				so->prefetchFinished = true;
+				break;
+			}
+			slot->iptr = so->item.iptr;
+			slot->recheck = recheck;
+		}
+		else
+		{
+			RumSortItem *item;
+			bool		should_free;
+
+			/*
+			 * Don't restart the bounded top-K scan before the consumer
+			 * actually wants more rows than the heap kept.
+			 */
+			if (so->topKItems && so->curTopKItem >= so->nTopKItems &&
+				so->nPrefetchItems > 0)
+				break;
+
+			item = getNextSortItem(scan, &should_free);
+			if (item == NULL)
+			{
+				so->prefetchFinished = true;
+				break;
+			}
+			memcpy(slot, item, RumSortItemSize(so->norderbys));
+			if (should_free)
+				pfree(item);
+		}
+
+		blkno = ItemPointerGetBlockNumber(&slot->iptr);
+		if (blkno != so->prefetchBlock && scan->heapRelation != NULL)
+		{
+			PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, blkno);
+			so->prefetchBlock = blkno;
+		}
+		so->nPrefetchItems++;
+	}
+}
+
+/*
+ * Returns the next item from the look-ahead ring.  The item is valid until
+ * the next call.
+ */
+static RumSortItem *
+getNextPrefetchedItem(IndexScanDesc scan)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+	RumSortItem *item;
+
+	prefetchScanItems(scan);
+
+	if (so->nPrefetchItems == 0)
+		return NULL;
+
+	item = so->prefetchItems[so->prefetchHead];
+	so->prefetchHead = (so->prefetchHead + 1) % so->prefetchDistance;
+	so->nPrefetchItems--;
+
+	return item;
+}
+
+/*
+ * Returns the next item of the collect-and-sort scan, through the
+ * look-ahead ring if heap prefetching is enabled.
+ */
+static RumSortItem *
+getNextResultItem(IndexScanDesc scan, bool *should_free)
+{
+	RumScanOpaque so = (RumScanOpaque) scan->opaque;
+
+	if (so->prefetchItems)
+	{
+		*should_free = false;
+		return getNextPrefetchedItem(scan);
+	}
+
+	return getNextSortItem(scan, should_free);
+}
+
 bool
 rumgettuple(IndexScanDesc scan, ScanDirection direction)
 {
@@ -2585,45 +3432,74 @@ rumgettuple(IndexScanDesc scan, ScanDirection direction)
 		so->firstCall = false;
 		ItemPointerSetInvalid(&GET_SCAN_TID(scan));
 
+		so->prefetchHead = 0;
+		so->nPrefetchItems = 0;
+		so->prefetchFinished = false;
+		so->prefetchBlock = InvalidBlockNumber;
+
 		if (RumIsVoidRes(scan))
 			return false;
 
-		startScan(scan);
-		if (so->naturalOrder == NoMovementScanDirection)
-		{
-			so->sortstate = rum_tuplesort_begin_rum(work_mem, so->norderbys,
-						false, so->scanType == RumFullScan);
-
+#ifdef RUM_INSERT_BUFFER
+		/* The scan must see the entries buffered by this backend */
+		rumFlushPendingInserts(scan->indexRelation);
+#endif
 
-			while (scanGetItem(scan, &so->item, &so->item, &recheck))
+		so->parallelChunks = false;
+#if PG_VERSION_NUM >= 100000
+		if (scan->parallel_scan)
+		{
+			/*
+			 * Scans in item pointer order could be divided between
+			 * participants, others are run by a single one.  Claim the scan
+			 * before starting it, so that the others don't do it in vain.
+			 */
+			if (so->naturalOrder == NoMovementScanDirection &&
+				!isFullScan(so) &&
+				!so->rumstate.useAlternativeOrder)
 			{
-				insertScanItem(so, recheck);
+				so->parallelChunks = true;
+				so->curChunk = InvalidBlockNumber;
+				so->hasNextItem = false;
+			}
+			else if (!rumParallelClaimScan(scan))
+			{
+				so->isVoidRes = true;
+				return false;
 			}
-			rum_tuplesort_performsort(so->sortstate);
 		}
+#endif
+
+		startScan(scan);
+
+		if (so->naturalOrder == NoMovementScanDirection)
+			collectSortItems(scan, !so->parallelChunks);
 	}
+	else if (RumIsVoidRes(scan))
+		return false;
 
 	if (so->naturalOrder != NoMovementScanDirection)
 	{
-		if (scanGetItem(scan, &so->item, &so->item, &recheck))
+		if (so->prefetchItems)
 		{
+			item = getNextPrefetchedItem(scan);
+			if (item == NULL)
+				return false;
+			SET_SCAN_TID(scan, item->iptr);
+			recheck = item->recheck;
+		}
+		else if (scanGetNaturalItem(scan, &recheck))
 			SET_SCAN_TID(scan, so->item.iptr);
-			scan->xs_recheck = recheck;
-			scan->xs_recheckorderby = false;
+		else
+			return false;
 
-			return true;
-		}
-		else if (so->secondPass == false)
-		{
-			reverseScan(scan);
-			so->secondPass = true;
-			return rumgettuple(scan, direction);
-		}
+		scan->xs_recheck = recheck;
+		scan->xs_recheckorderby = false;
 
-		return false;
+		return true;
 	}
 
-	item = rum_tuplesort_getrum(so->sortstate, true, &should_free);
+	item = getNextResultItem(scan, &should_free);
 	while (item)
 	{
 		uint32		i,
@@ -2633,7 +3509,7 @@ rumgettuple(IndexScanDesc scan, ScanDirection direction)
 		{
 			if (should_free)
 				pfree(item);
-			item = rum_tuplesort_getrum(so->sortstate, true, &should_free);
+			item = getNextResultItem(scan, &should_free);
 			continue;
 		}
 
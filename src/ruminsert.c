@@ -15,15 +15,39 @@
 
 #include "access/generic_xlog.h"
 #if PG_VERSION_NUM >= 120000
+#include "access/parallel.h"
+#include "access/relation.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
+#include "access/xloginsert.h"
+#include "lib/binaryheap.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/planmain.h"
+#include "optimizer/planner.h"
+#include "pgstat.h"
+#include "storage/buffile.h"
+#include "storage/condition_variable.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "utils/snapmgr.h"
 #endif
 #include "storage/predicate.h"
 #include "catalog/index.h"
+#include "executor/executor.h"
 #include "miscadmin.h"
 #include "utils/datum.h"
 
 #include "rum.h"
 
+/*
+ * Parallel index build is supported starting from PostgreSQL 12, which
+ * provides the parallel table scan API.
+ */
+#if PG_VERSION_NUM >= 120000
+#define RUM_PARALLEL_BUILD
+#endif
+
 typedef struct
 {
 	RumState	rumstate;
@@ -32,8 +56,155 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+	int			workMem;		/* accumulator size limit, in kB */
+#ifdef RUM_PARALLEL_BUILD
+	bool		writeRuns;		/* flush entries to sorted runs */
+	List	   *runs;			/* temporary files of the runs */
+	MemoryContext runsCtx;		/* memory of the runs */
+#endif
 }	RumBuildState;
 
+#ifdef RUM_PARALLEL_BUILD
+/*
+ * Parallel build: the leader and the workers scan the heap, accumulate
+ * entries in their own BuildAccumulators and write them in key order to
+ * temporary files each time the accumulator fills.  At the end of the scan
+ * each worker merges its sorted runs and sends the merged stream to the
+ * leader through a shared memory queue.  The leader merges the streams of
+ * the workers with its own runs, so that each key is inserted into the index
+ * once with all its items in order.
+ */
+#define PARALLEL_KEY_RUM_SHARED		UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_RUM_QUEUES		UINT64CONST(0xB000000000000002)
+
+/* Size of the queue of each worker */
+#define RUM_PARALLEL_QUEUE_SIZE		(256 * 1024)
+/* Items are sent by messages of about this size */
+#define RUM_PARALLEL_MESSAGE_SIZE	(64 * 1024)
+/* Number of items read from a stream at once */
+#define RUM_BUILD_READ_ITEMS		1024
+
+typedef struct RumBuildShared
+{
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+
+	/* Workers wait on it until the leader sets workMem */
+	ConditionVariable workMemCV;
+
+	/* Protected by mutex */
+	slock_t		mutex;
+	int			workMem;		/* accumulator size of each participant, in
+								 * kB, zero until the workers are launched */
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain; /* some participant met a broken HOT chain */
+
+	/*
+	 * ParallelTableScanDescData data follows.  Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+}	RumBuildShared;
+
+#define ParallelTableScanFromRumBuildShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(RumBuildShared)))
+
+/*
+ * A worker sends its merged stream as a sequence of messages.  The key
+ * message is followed by the serialized key and starts the next key.  The
+ * items message carries nitems items of the current key, each of them is an
+ * item pointer and serialized addInfo.  The end message means that the
+ * worker has finished.
+ */
+typedef enum
+{
+	RUM_BUILD_MSG_KEY,
+	RUM_BUILD_MSG_ITEMS,
+	RUM_BUILD_MSG_END
+}	RumBuildMessageType;
+
+typedef struct RumBuildMessageHeader
+{
+	RumBuildMessageType type;
+	OffsetNumber attnum;
+	RumNullCategory category;
+	uint32		nitems;
+}	RumBuildMessageHeader;
+
+/*
+ * Header of a key in a sorted run.  It's followed by the serialized key and
+ * nitems items in the same format as in the messages.  A header with invalid
+ * attnum ends the run.
+ */
+typedef struct RumBuildRunHeader
+{
+	OffsetNumber attnum;
+	RumNullCategory category;
+	uint32		nitems;
+}	RumBuildRunHeader;
+
+/*
+ * A key-ordered stream of entries: a sorted run, a queue of a worker or a
+ * merge of other streams.  nextKey() moves to the next key and returns false
+ * at the end of the stream.  readItems() returns up to maxitems next items of
+ * the current key in the posting tree order, and zero once they are over,
+ * which must happen before the next nextKey() call.  The key is valid until
+ * the next nextKey() call, and the items until the next readItems() call.
+ */
+typedef struct RumBuildStream RumBuildStream;
+
+struct RumBuildStream
+{
+	bool		(*nextKey) (RumBuildStream * stream);
+	uint32		(*readItems) (RumBuildStream * stream, RumItem * items,
+							  uint32 maxitems);
+
+	RumState   *rumstate;
+	OffsetNumber attnum;
+	Datum		key;
+	RumNullCategory category;
+};
+
+typedef struct
+{
+	RumBuildStream stream;
+	BufFile    *file;
+	uint32		nleft;			/* items of the current key not read yet */
+	MemoryContext keyCtx;
+	MemoryContext itemsCtx;
+}	RumBuildRun;
+
+typedef struct
+{
+	RumBuildStream stream;
+	shm_mq_handle *mqh;
+	RumBuildMessageHeader hdr;	/* header of the last received message */
+	char	   *data;			/* its unread data */
+	uint32		nleft;			/* its unread items */
+	MemoryContext keyCtx;
+	MemoryContext itemsCtx;
+}	RumBuildQueue;
+
+typedef struct
+{
+	RumBuildStream stream;
+	int			nchildren;
+	RumBuildStream **children;
+	binaryheap *keyHeap;		/* children ahead of the current key */
+	int		   *current;		/* children at the current key */
+	int			ncurrent;
+	binaryheap *itemHeap;		/* current children by their next item */
+	RumItem   **buffers;		/* items read from each child */
+	uint32	   *nbuffered;
+	uint32	   *pos;
+	bool	   *finished;		/* the child has no more items of the key */
+}	RumBuildMerge;
+
+PGDLLEXPORT void _rum_parallel_build_main(dsm_segment *seg, shm_toc *toc);
+#endif
+
 
 #if PG_VERSION_NUM >= 120000
 #define IndexBuildHeapScan(A, B, C, D, E, F) \
@@ -44,60 +215,240 @@ IndexBuildHeapScan(A, B, C, D, E, F, NULL)
 #endif
 
 /*
- * Creates new posting tree with one page, containing the given TIDs.
- * Returns the page number (which will be the root of this posting tree).
- *
- * items[] must be in sorted order with no duplicates.
+ * State of one level of a posting tree being loaded bottom-up by
+ * createPostingTree().  Pages are filled in local memory from left to right,
+ * and each page is written out as soon as the next one is started, because
+ * only then its rightlink is known.  Downlinks to the written pages are
+ * collected to become the items of the next level up.
  */
-static BlockNumber
-createPostingTree(RumState * rumstate, OffsetNumber attnum, Relation index,
-				  RumItem * items, uint32 nitems)
+typedef struct
 {
-	BlockNumber blkno;
-	Buffer		buffer = RumNewBuffer(index);
+	RumState   *rumstate;
+	uint32		flags;			/* RUM_DATA, plus RUM_LEAF for the leaf level */
+	Page		page;			/* page being filled */
+	Buffer		buffer;			/* its buffer, InvalidBuffer until we know
+								 * the page isn't the root */
+	BlockNumber leftlink;
+
+	RumPostingItem *downlinks;
+	int			ndownlinks;
+	int			maxdownlinks;
+
+	GinStatsData *buildStats;
+} RumPostingTreeLevel;
+
+static void
+postingTreeLevelInit(RumPostingTreeLevel * level, RumState * rumstate,
+					 uint32 flags, int maxdownlinks, GinStatsData *buildStats)
+{
+	level->rumstate = rumstate;
+	level->flags = flags;
+	level->page = (Page) palloc(BLCKSZ);
+	level->buffer = InvalidBuffer;
+	level->leftlink = InvalidBlockNumber;
+	level->ndownlinks = 0;
+	level->maxdownlinks = Max(maxdownlinks, 1);
+	level->downlinks = (RumPostingItem *)
+		palloc(sizeof(RumPostingItem) * level->maxdownlinks);
+	level->buildStats = buildStats;
+
+	RumInitPage(level->page, flags, BLCKSZ);
+}
+
+/*
+ * Copy the page image into its buffer, remember the downlink to it for the
+ * upper level, and release the buffer.
+ */
+static void
+postingTreeLevelWritePage(RumPostingTreeLevel * level)
+{
+	RumState   *rumstate = level->rumstate;
+	RumPostingItem *downlink;
 	Page		page;
-	int			i;
-	Pointer		ptr;
-	ItemPointerData prev_iptr = {{0, 0}, 0};
 	GenericXLogState *state = NULL;
 
+	if (level->ndownlinks >= level->maxdownlinks)
+	{
+		level->maxdownlinks *= 2;
+		level->downlinks = (RumPostingItem *)
+			repalloc(level->downlinks,
+					 sizeof(RumPostingItem) * level->maxdownlinks);
+	}
+	downlink = &level->downlinks[level->ndownlinks++];
+	memset(downlink, 0, sizeof(RumPostingItem));
+	RumPostingItemSetBlockNumber(downlink, BufferGetBlockNumber(level->buffer));
+	downlink->item = *RumDataPageGetRightBound(level->page);
+
 	if (rumstate->isBuild)
 	{
-		page = BufferGetPage(buffer);
+		page = BufferGetPage(level->buffer);
 		START_CRIT_SECTION();
 	}
 	else
 	{
-		state = GenericXLogStart(index);
-		page = GenericXLogRegisterBuffer(state, buffer, GENERIC_XLOG_FULL_IMAGE);
+		state = GenericXLogStart(rumstate->index);
+		page = GenericXLogRegisterBuffer(state, level->buffer,
+										 GENERIC_XLOG_FULL_IMAGE);
 	}
-	RumInitPage(page, RUM_DATA | RUM_LEAF, BufferGetPageSize(buffer));
-
-	blkno = BufferGetBlockNumber(buffer);
 
-	RumPageGetOpaque(page)->maxoff = nitems;
-	ptr = RumDataPageGetData(page);
-	for (i = 0; i < nitems; i++)
-	{
-		if (i > 0)
-			prev_iptr = items[i - 1].iptr;
-		ptr = rumPlaceToDataPageLeaf(ptr, attnum, &items[i],
-									 &prev_iptr, rumstate);
-	}
-	Assert(RumDataPageFreeSpacePre(page, ptr) >= 0);
-	updateItemIndexes(page, attnum, rumstate);
+	memcpy(page, level->page, BLCKSZ);
 
 	if (rumstate->isBuild)
-		MarkBufferDirty(buffer);
+		MarkBufferDirty(level->buffer);
 	else
 		GenericXLogFinish(state);
 
-	UnlockReleaseBuffer(buffer);
+	UnlockReleaseBuffer(level->buffer);
 
 	if (rumstate->isBuild)
 		END_CRIT_SECTION();
 
-	return blkno;
+	/* During index build, count the newly-added data page */
+	if (level->buildStats)
+		level->buildStats->nDataPages++;
+}
+
+/*
+ * Current page is full and more items follow: write it out with the given
+ * right bound and start a new page to the right of it.
+ */
+static void
+postingTreeLevelNextPage(RumPostingTreeLevel * level, RumItem * rightBound)
+{
+	Buffer		nextBuffer;
+	BlockNumber blkno;
+
+	if (level->buffer == InvalidBuffer)
+		level->buffer = RumNewBuffer(level->rumstate->index);
+	blkno = BufferGetBlockNumber(level->buffer);
+
+	nextBuffer = RumNewBuffer(level->rumstate->index);
+
+	RumPageGetOpaque(level->page)->leftlink = level->leftlink;
+	RumPageGetOpaque(level->page)->rightlink = BufferGetBlockNumber(nextBuffer);
+	*RumDataPageGetRightBound(level->page) = *rightBound;
+
+	postingTreeLevelWritePage(level);
+
+	level->buffer = nextBuffer;
+	level->leftlink = blkno;
+	RumInitPage(level->page, level->flags, BLCKSZ);
+}
+
+/*
+ * Write out the rightmost page of the level.  Its right bound stays at
+ * "minus infinity" set by RumInitPage(), as on any rightmost page.  Returns
+ * true if the level consists of this single page, i.e. it's the root.
+ */
+static bool
+postingTreeLevelFinish(RumPostingTreeLevel * level)
+{
+	bool		isRoot = (level->buffer == InvalidBuffer);
+
+	if (isRoot)
+		level->buffer = RumNewBuffer(level->rumstate->index);
+
+	RumPageGetOpaque(level->page)->leftlink = level->leftlink;
+	postingTreeLevelWritePage(level);
+
+	pfree(level->page);
+	return isRoot;
+}
+
+/*
+ * Creates new posting tree containing the given TIDs.  Returns the page number
+ * of its root.
+ *
+ * items[] must be in sorted order with no duplicates.  The tree is loaded
+ * bottom-up: leaf pages are packed from left to right up to the index
+ * fillfactor, then each upper level is built from the downlinks of the level
+ * below until a level fits on a single page.  This is much cheaper than
+ * descending the tree for every page worth of items, and leaves no half-empty
+ * pages behind splits.  The free space left on the leaves takes later
+ * insertions, in particular appends to the rightmost leaf, without splits.
+ */
+static BlockNumber
+createPostingTree(RumState * rumstate, OffsetNumber attnum, Relation index,
+				  RumItem * items, uint32 nitems, GinStatsData *buildStats)
+{
+	RumPostingTreeLevel level;
+	BlockNumber rootBlkno;
+	RumPostingItem *children;
+	int			nchildren;
+	Pointer		ptr;
+	ItemPointerData prevIptr;
+	Size		size = 0;
+	OffsetNumber maxoff = 0;
+	int			maxPostingItems;
+	Size		leafSize;
+	uint32		i;
+
+	Assert(nitems > 0);
+	Assert(index == rumstate->index);
+
+	leafSize = RumDataPageSize * RumGetFillFactor(index) / 100;
+
+	/* Leaf level */
+	postingTreeLevelInit(&level, rumstate, RUM_DATA | RUM_LEAF,
+						 nitems / RumMaxLeafDataItems + 1, buildStats);
+
+	ptr = RumDataPageGetData(level.page);
+	RumItemPointerSetMin(&prevIptr);
+	for (i = 0; i < nitems; i++)
+	{
+		size = rumCheckPlaceToDataPageLeaf(attnum, &items[i], &prevIptr,
+										   rumstate, size);
+		if (size >= leafSize && maxoff > 0)
+		{
+			RumPageGetOpaque(level.page)->maxoff = maxoff;
+			Assert(RumDataPageFreeSpacePre(level.page, ptr) >= 0);
+			updateItemIndexes(level.page, attnum, rumstate);
+			postingTreeLevelNextPage(&level, &items[i - 1]);
+
+			ptr = RumDataPageGetData(level.page);
+			RumItemPointerSetMin(&prevIptr);
+			maxoff = 0;
+			size = rumCheckPlaceToDataPageLeaf(attnum, &items[i], &prevIptr,
+											   rumstate, 0);
+		}
+
+		ptr = rumPlaceToDataPageLeaf(ptr, attnum, &items[i], &prevIptr,
+									 rumstate);
+		prevIptr = items[i].iptr;
+		maxoff++;
+	}
+	RumPageGetOpaque(level.page)->maxoff = maxoff;
+	Assert(RumDataPageFreeSpacePre(level.page, ptr) >= 0);
+	updateItemIndexes(level.page, attnum, rumstate);
+
+	/* Internal levels, up to the root */
+	maxPostingItems = (BLCKSZ - MAXALIGN(SizeOfPageHeaderData) -
+					   MAXALIGN(sizeof(RumItem)) -
+					   MAXALIGN(sizeof(RumPageOpaqueData))) /
+		sizeof(RumPostingItem);
+	while (!postingTreeLevelFinish(&level))
+	{
+		children = level.downlinks;
+		nchildren = level.ndownlinks;
+
+		postingTreeLevelInit(&level, rumstate, RUM_DATA,
+							 nchildren / maxPostingItems + 1, buildStats);
+
+		for (i = 0; i < nchildren; i++)
+		{
+			if (RumDataPageGetFreeSpace(level.page) < sizeof(RumPostingItem))
+				postingTreeLevelNextPage(&level, &children[i - 1].item);
+			RumDataPageAddItem(level.page, &children[i], InvalidOffsetNumber);
+		}
+
+		pfree(children);
+	}
+
+	Assert(level.ndownlinks == 1);
+	rootBlkno = RumPostingItemGetBlockNumber(&level.downlinks[0]);
+	pfree(level.downlinks);
+
+	return rootBlkno;
 }
 
 /*
@@ -292,29 +643,17 @@ addItemPointersToLeafTuple(RumState * rumstate,
 	{
 		/* posting list would be too big, convert to posting tree */
 		BlockNumber postingRoot;
-		RumPostingTreeScan *gdi;
 
 		/*
-		 * Initialize posting tree with the old tuple's posting list.  It's
-		 * surely small enough to fit on one posting-tree page, and should
-		 * already be in order with no duplicates.
+		 * Load the posting tree with the merged list of old and new TIDs at
+		 * once, it's already in order with no duplicates.
 		 */
 		postingRoot = createPostingTree(rumstate,
 										attnum,
 										rumstate->index,
-										oldItems,
-										oldNPosting);
-
-		/* During index build, count the newly-added data page */
-		if (buildStats)
-			buildStats->nDataPages++;
-
-		/* Now insert the TIDs-to-be-added into the posting tree */
-		gdi = rumPrepareScanPostingTree(rumstate->index, postingRoot, false,
-										ForwardScanDirection, attnum, rumstate);
-		rumInsertItemPointers(rumstate, attnum, gdi, items, nitem, buildStats);
-
-		pfree(gdi);
+										newItems,
+										newNPosting,
+										buildStats);
 
 		/* And build a new posting-tree-only result tuple */
 		res = RumFormTuple(rumstate, attnum, key, category, NULL, 0, true);
@@ -324,6 +663,134 @@ addItemPointersToLeafTuple(RumState * rumstate,
 	return res;
 }
 
+/*
+ * Try to append items to the posting list of the leaf tuple at stack->off
+ * in place, if they all sort after the items already there.  Only the tail
+ * of the varbyte posting list and the number of items change, so there is
+ * no need to merge and re-encode the whole list, and if the tuple's
+ * alignment padding is enough for the new items, only the changed bytes go
+ * to WAL.  Returns false if the items can't be appended, then the caller
+ * has to rebuild the tuple.
+ */
+static bool
+appendItemPointersToLeafTuple(RumState * rumstate, OffsetNumber attnum,
+							  RumBtreeStack * stack,
+							  RumItem * items, uint32 nitem)
+{
+	Page		page = BufferGetPage(stack->buffer);
+	IndexTuple	itup = (IndexTuple) PageGetItem(page,
+											PageGetItemId(page, stack->off));
+	RumNullCategory category;
+	RumItem    *oldItems;
+	ItemPointerData iptr;
+	int			oldNPosting = RumGetNPosting(itup);
+	Size		oldsize = IndexTupleSize(itup),
+				dataEnd,
+				newsize;
+	IndexTuple	newItup = NULL;
+	GenericXLogState *state = NULL;
+	Page		newPage;
+	char	   *ptr;
+	uint32		i;
+
+	if (oldNPosting == 0 || oldNPosting + nitem >= RUM_TREE_POSTING)
+		return false;
+
+	(void) rumtuple_get_key(rumstate, itup, &category);
+
+	/* Find the end of the posting list and its last item */
+	oldItems = (RumItem *) palloc(sizeof(RumItem) * oldNPosting);
+	RumItemPointerSetMin(&iptr);
+	ptr = rumDataPageLeafReadItems(RumGetPosting(itup), attnum, &iptr,
+								   oldItems, oldNPosting, false, rumstate);
+	dataEnd = ptr - (char *) itup;
+
+	if (compareRumItem(rumstate, attnum, &items[0],
+					   &oldItems[oldNPosting - 1]) <= 0)
+	{
+		pfree(oldItems);
+		return false;
+	}
+
+	newsize = rumCheckPlaceToDataPageLeaf(attnum, &items[0],
+										  &oldItems[oldNPosting - 1].iptr,
+										  rumstate, dataEnd);
+	for (i = 1; i < nitem; i++)
+		newsize = rumCheckPlaceToDataPageLeaf(attnum, &items[i],
+											  &items[i - 1].iptr,
+											  rumstate, newsize);
+	if (category != RUM_CAT_NORM_KEY)
+		newsize += sizeof(RumNullCategory);
+	newsize = MAXALIGN(newsize);
+
+	if (newsize > RumMaxItemSize)
+	{
+		pfree(oldItems);
+		return false;
+	}
+
+	if (newsize != oldsize)
+	{
+#if PG_VERSION_NUM >= 100000
+		if (newsize - oldsize > PageGetExactFreeSpace(page))
+#endif
+		{
+			pfree(oldItems);
+			return false;
+		}
+
+		/* The tuple grows, so build its new version and replace it */
+		newItup = (IndexTuple) palloc0(newsize);
+		memcpy(newItup, itup, dataEnd);
+		newItup->t_info &= ~INDEX_SIZE_MASK;
+		newItup->t_info |= newsize;
+	}
+
+	if (rumstate->isBuild)
+	{
+		newPage = page;
+		START_CRIT_SECTION();
+	}
+	else
+	{
+		state = GenericXLogStart(rumstate->index);
+		newPage = GenericXLogRegisterBuffer(state, stack->buffer, 0);
+	}
+
+	if (newItup == NULL)
+		newItup = (IndexTuple) PageGetItem(newPage,
+										   PageGetItemId(newPage, stack->off));
+
+	ptr = (char *) newItup + dataEnd;
+	ptr = rumPlaceToDataPageLeaf(ptr, attnum, &items[0],
+								 &oldItems[oldNPosting - 1].iptr, rumstate);
+	for (i = 1; i < nitem; i++)
+		ptr = rumPlaceToDataPageLeaf(ptr, attnum, &items[i],
+									 &items[i - 1].iptr, rumstate);
+	RumSetNPosting(newItup, oldNPosting + nitem);
+	if (category != RUM_CAT_NORM_KEY)
+		RumSetNullCategory(newItup, category);
+
+#if PG_VERSION_NUM >= 100000
+	if (newsize != oldsize &&
+		!PageIndexTupleOverwrite(newPage, stack->off, (Item) newItup, newsize))
+		elog(ERROR, "failed to replace tuple in index \"%s\"",
+			 RelationGetRelationName(rumstate->index));
+#endif
+
+	if (rumstate->isBuild)
+	{
+		MarkBufferDirty(stack->buffer);
+		END_CRIT_SECTION();
+	}
+	else
+		GenericXLogFinish(state);
+
+	pfree(oldItems);
+
+	return true;
+}
+
 /*
  * Build a fresh leaf tuple, either posting-list or posting-tree format
  * depending on whether the given items list will fit.
@@ -346,21 +813,6 @@ buildFreshLeafTuple(RumState * rumstate,
 	{
 		/* posting list would be too big, build posting tree */
 		BlockNumber postingRoot;
-		ItemPointerData prevIptr = {{0, 0}, 0};
-		Size		size = 0;
-		int			itemsCount = 0;
-
-		do
-		{
-			size = rumCheckPlaceToDataPageLeaf(attnum, &items[itemsCount],
-											   &prevIptr, rumstate, size);
-			prevIptr = items[itemsCount].iptr;
-			itemsCount++;
-		}
-		while (itemsCount < nitem && size < RumDataPageSize);
-
-		if (size >= RumDataPageSize)
-			itemsCount--;
 
 		/*
 		 * Build posting-tree-only result tuple.  We do this first so as to
@@ -368,44 +820,57 @@ buildFreshLeafTuple(RumState * rumstate,
 		 */
 		res = RumFormTuple(rumstate, attnum, key, category, NULL, 0, true);
 
-		/*
-		 * Initialize posting tree with as many TIDs as will fit on the first
-		 * page.
-		 */
+		/* Load all the TIDs into a new posting tree */
 		postingRoot = createPostingTree(rumstate,
 										attnum,
 										rumstate->index,
 										items,
-										itemsCount);
+										nitem,
+										buildStats);
 
-		/* During index build, count the newly-added data page */
-		if (buildStats)
-			buildStats->nDataPages++;
+		/* And save the root link in the result tuple */
+		RumSetPostingTree(res, postingRoot);
+	}
 
-		/* Add any remaining TIDs to the posting tree */
-		if (nitem > itemsCount)
-		{
-			RumPostingTreeScan *gdi;
+	return res;
+}
 
-			gdi = rumPrepareScanPostingTree(rumstate->index, postingRoot, false,
-											ForwardScanDirection,
-											attnum, rumstate);
+/*
+ * Try to find the entry tree leaf for the key starting from the leaf where
+ * the previous, smaller key was inserted, instead of descending from the
+ * root.  Entry pages are never deleted and split only to the right, so the
+ * leaf still can't start after the key; it's enough to check that it
+ * doesn't end before it.
+ *
+ * The leaf is taken only if any entry tuple fits it, so it's never split:
+ * a split needs the path from the root, which we don't have.  Returns NULL
+ * if the descent is needed.
+ */
+static RumBtreeStack *
+entryFindLeafFromHint(RumBtree btree, BlockNumber leafHint)
+{
+	RumBtreeStack *stack = (RumBtreeStack *) palloc(sizeof(RumBtreeStack));
+	Page		page;
 
-			rumInsertItemPointers(rumstate,
-								  attnum,
-								  gdi,
-								  items + itemsCount,
-								  nitem - itemsCount,
-								  buildStats);
+	stack->blkno = leafHint;
+	stack->buffer = ReadBuffer(btree->index, leafHint);
+	stack->off = InvalidOffsetNumber;
+	stack->predictNumber = 1;
+	stack->parent = NULL;
 
-			pfree(gdi);
-		}
+	LockBuffer(stack->buffer, RUM_EXCLUSIVE);
+	page = BufferGetPage(stack->buffer);
 
-		/* And save the root link in the result tuple */
-		RumSetPostingTree(res, postingRoot);
+	if (RumPageIsData(page) || !RumPageIsLeaf(page) ||
+		PageGetFreeSpace(page) < RumMaxItemSize + sizeof(ItemIdData) ||
+		btree->isMoveRight(btree, page))
+	{
+		LockBuffer(stack->buffer, RUM_UNLOCK);
+		freeRumBtreeStack(stack);
+		return NULL;
 	}
 
-	return res;
+	return stack;
 }
 
 /*
@@ -414,17 +879,23 @@ buildFreshLeafTuple(RumState * rumstate,
  *
  * During an index build, buildStats is non-null and the counters
  * it contains should be incremented as needed.
+ *
+ * If leafHint is not NULL, the keys are inserted in ascending order and
+ * *leafHint keeps the entry leaf of the previous key (InvalidBlockNumber
+ * initially).  Adjacent keys usually share a leaf, so the descent from the
+ * root is skipped for them.
  */
 void
 rumEntryInsert(RumState * rumstate,
 			   OffsetNumber attnum, Datum key, RumNullCategory category,
 			   RumItem * items, uint32 nitem,
-			   GinStatsData *buildStats)
+			   GinStatsData *buildStats, BlockNumber *leafHint)
 {
 	RumBtreeData btree;
-	RumBtreeStack *stack;
+	RumBtreeStack *stack = NULL;
 	IndexTuple	itup;
 	Page		page;
+	bool		fromHint PG_USED_FOR_ASSERTS_ONLY = false;
 
 	/* During index build, count the to-be-inserted entry */
 	if (buildStats)
@@ -432,9 +903,18 @@ rumEntryInsert(RumState * rumstate,
 
 	rumPrepareEntryScan(&btree, attnum, key, category, rumstate);
 
-	stack = rumFindLeafPage(&btree, NULL);
+	if (leafHint && *leafHint != InvalidBlockNumber)
+	{
+		stack = entryFindLeafFromHint(&btree, *leafHint);
+		fromHint = (stack != NULL);
+	}
+	if (stack == NULL)
+		stack = rumFindLeafPage(&btree, NULL);
 	page = BufferGetPage(stack->buffer);
 
+	if (leafHint)
+		*leafHint = stack->blkno;
+
 	CheckForSerializableConflictIn(btree.index, NULL, stack->buffer);
 
 	if (btree.findItem(&btree, stack))
@@ -463,6 +943,15 @@ rumEntryInsert(RumState * rumstate,
 			return;
 		}
 
+		/* cheap path: new items go to the end of the posting list */
+		if (appendItemPointersToLeafTuple(rumstate, attnum, stack,
+										  items, nitem))
+		{
+			LockBuffer(stack->buffer, RUM_UNLOCK);
+			freeRumBtreeStack(stack);
+			return;
+		}
+
 		/* modify an existing leaf entry */
 		itup = addItemPointersToLeafTuple(rumstate, itup,
 										  items, nitem, buildStats);
@@ -478,6 +967,11 @@ rumEntryInsert(RumState * rumstate,
 
 	/* Insert the new or modified leaf tuple */
 	btree.entry = itup;
+
+	/* The leaf found without descent has room for any entry */
+	Assert(!fromHint ||
+		   btree.isEnoughSpace(&btree, stack->buffer, stack->off));
+
 	rumInsertValue(rumstate->index, &btree, stack, buildStats);
 	pfree(itup);
 }
@@ -549,89 +1043,1410 @@ rumHeapTupleBulkInsert(RumBuildState * buildstate, OffsetNumber attnum,
 	MemoryContextReset(buildstate->funcCtx);
 }
 
+#ifdef RUM_PARALLEL_BUILD
 static void
-rumBuildCallback(Relation index,
-#if PG_VERSION_NUM < 130000
-				 HeapTuple htup,
+rumBufFileWrite(BufFile *file, void *ptr, size_t size)
+{
+#if PG_VERSION_NUM >= 130000
+	BufFileWrite(file, ptr, size);
 #else
-				 ItemPointer tid,
+	if (BufFileWrite(file, ptr, size) != size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to RUM build temporary file: %m")));
 #endif
-				 Datum *values,
-				 bool *isnull, bool tupleIsAlive, void *state)
+}
+
+static void
+rumBufFileRead(BufFile *file, void *ptr, size_t size)
 {
-	RumBuildState *buildstate = (RumBuildState *) state;
-	MemoryContext oldCtx;
-	int			i;
-	Datum		outerAddInfo = (Datum) 0;
-	bool		outerAddInfoIsNull = true;
-#if PG_VERSION_NUM < 130000
-	ItemPointer tid = &htup->t_self;
+#if PG_VERSION_NUM >= 160000
+	BufFileReadExact(file, ptr, size);
+#else
+	if (BufFileRead(file, ptr, size) != size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from RUM build temporary file")));
 #endif
+}
 
-	if (AttributeNumberIsValid(buildstate->rumstate.attrnAttachColumn))
-	{
-		outerAddInfo = values[buildstate->rumstate.attrnAttachColumn - 1];
-		outerAddInfoIsNull = isnull[buildstate->rumstate.attrnAttachColumn - 1];
-	}
-
-	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+/*
+ * Write a datum to a run in the datumSerialize() format.
+ */
+static void
+rumBuildWriteDatum(BufFile *file, Datum value, bool isnull,
+				   bool typByVal, int typLen)
+{
+	Size		size = datumEstimateSpace(value, isnull, typByVal, typLen);
+	char	   *buffer,
+			   *ptr;
+
+	ptr = buffer = palloc(size);
+	datumSerialize(value, isnull, typByVal, typLen, &ptr);
+	rumBufFileWrite(file, buffer, size);
+	pfree(buffer);
+}
 
-	for (i = 0; i < buildstate->rumstate.origTupdesc->natts; i++)
+/*
+ * Read a datum written by rumBuildWriteDatum().  Its int header is -2 for
+ * NULL, -1 for a pass-by-value datum and the data length otherwise.
+ */
+static Datum
+rumBuildReadDatum(BufFile *file, bool *isnull)
+{
+	int			header;
+	Size		size;
+	char	   *buffer,
+			   *ptr;
+	Datum		value;
+
+	rumBufFileRead(file, &header, sizeof(header));
+	if (header == -2)
+		size = 0;
+	else if (header == -1)
+		size = sizeof(Datum);
+	else
+		size = header;
+
+	ptr = buffer = palloc(sizeof(header) + size);
+	memcpy(buffer, &header, sizeof(header));
+	if (size > 0)
+		rumBufFileRead(file, buffer + sizeof(header), size);
+
+	/* datumRestore() copies pass-by-reference data */
+	value = datumRestore(&ptr, isnull);
+	pfree(buffer);
+
+	return value;
+}
+
+/*
+ * Write all entries of the build accumulator to a new sorted run.
+ */
+static void
+rumBuildWriteRun(RumBuildState * buildstate)
+{
+	RumState   *rumstate = &buildstate->rumstate;
+	BufFile    *file;
+	RumBuildRunHeader hdr;
+	RumItem    *items;
+	Datum		key;
+	RumNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+	MemoryContext oldCtx;
+
+	/* The run outlives the accumulator */
+	oldCtx = MemoryContextSwitchTo(buildstate->runsCtx);
+	file = BufFileCreateTemp(false);
+	buildstate->runs = lappend(buildstate->runs, file);
+	MemoryContextSwitchTo(oldCtx);
+
+	rumBeginBAScan(&buildstate->accum);
+	while ((items = rumGetBAEntry(&buildstate->accum,
+								  &attnum, &key, &category, &nlist)) != NULL)
+	{
+		Form_pg_attribute keyAttr = RumTupleDescAttr(rumstate->origTupdesc,
+													 attnum - 1);
+		Form_pg_attribute addAttr = rumstate->addAttrs[attnum - 1];
+		uint32		i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		hdr.attnum = attnum;
+		hdr.category = category;
+		hdr.nitems = nlist;
+		rumBufFileWrite(file, &hdr, sizeof(hdr));
+		rumBuildWriteDatum(file, key, category != RUM_CAT_NORM_KEY,
+						   keyAttr->attbyval, keyAttr->attlen);
+
+		for (i = 0; i < nlist; i++)
+		{
+			rumBufFileWrite(file, &items[i].iptr, sizeof(ItemPointerData));
+			rumBuildWriteDatum(file, items[i].addInfo, items[i].addInfoIsNull,
+							   addAttr ? addAttr->attbyval : true,
+							   addAttr ? addAttr->attlen : sizeof(Datum));
+		}
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.attnum = InvalidOffsetNumber;
+	rumBufFileWrite(file, &hdr, sizeof(hdr));
+}
+
+static bool
+rumBuildRunNextKey(RumBuildStream * stream)
+{
+	RumBuildRun *run = (RumBuildRun *) stream;
+	RumBuildRunHeader hdr;
+	MemoryContext oldCtx;
+	bool		keyIsNull;
+
+	Assert(run->nleft == 0);
+
+	rumBufFileRead(run->file, &hdr, sizeof(hdr));
+	if (hdr.attnum == InvalidOffsetNumber)
+	{
+		/* release the disk space early */
+		BufFileClose(run->file);
+		run->file = NULL;
+		return false;
+	}
+
+	MemoryContextReset(run->keyCtx);
+	oldCtx = MemoryContextSwitchTo(run->keyCtx);
+	stream->key = rumBuildReadDatum(run->file, &keyIsNull);
+	MemoryContextSwitchTo(oldCtx);
+
+	stream->attnum = hdr.attnum;
+	stream->category = hdr.category;
+	run->nleft = hdr.nitems;
+
+	return true;
+}
+
+static uint32
+rumBuildRunReadItems(RumBuildStream * stream, RumItem * items,
+					 uint32 maxitems)
+{
+	RumBuildRun *run = (RumBuildRun *) stream;
+	uint32		n = Min(run->nleft, maxitems),
+				i;
+	MemoryContext oldCtx;
+
+	MemoryContextReset(run->itemsCtx);
+	oldCtx = MemoryContextSwitchTo(run->itemsCtx);
+	for (i = 0; i < n; i++)
+	{
+		rumBufFileRead(run->file, &items[i].iptr, sizeof(ItemPointerData));
+		items[i].addInfo = rumBuildReadDatum(run->file,
+											 &items[i].addInfoIsNull);
+	}
+	MemoryContextSwitchTo(oldCtx);
+
+	run->nleft -= n;
+	return n;
+}
+
+static RumBuildStream *
+rumBuildRunBegin(RumState * rumstate, BufFile *file)
+{
+	RumBuildRun *run = (RumBuildRun *) palloc0(sizeof(RumBuildRun));
+
+	if (BufFileSeek(file, 0, 0L, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind RUM build temporary file")));
+
+	run->stream.nextKey = rumBuildRunNextKey;
+	run->stream.readItems = rumBuildRunReadItems;
+	run->stream.rumstate = rumstate;
+	run->file = file;
+	run->keyCtx = RumContextCreate(CurrentMemoryContext,
+								   "Rum build run key context");
+	run->itemsCtx = RumContextCreate(CurrentMemoryContext,
+									 "Rum build run items context");
+
+	return &run->stream;
+}
+
+/*
+ * Receive the next message from the worker.  Its data stays valid until the
+ * next call.
+ */
+static void
+rumBuildQueueReceive(RumBuildQueue * queue)
+{
+	shm_mq_result res;
+	Size		nbytes;
+	void	   *data;
+
+	res = shm_mq_receive(queue->mqh, &nbytes, &data, false);
+	if (res != SHM_MQ_SUCCESS)
+	{
+		/* Rethrow the error of the worker if any */
+		HandleParallelMessages();
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("parallel worker of RUM index build exited unexpectedly")));
+	}
+
+	if (nbytes < sizeof(RumBuildMessageHeader))
+		elog(ERROR, "invalid message size %zu from parallel worker", nbytes);
+
+	memcpy(&queue->hdr, data, sizeof(RumBuildMessageHeader));
+	queue->data = (char *) data + sizeof(RumBuildMessageHeader);
+	queue->nleft = (queue->hdr.type == RUM_BUILD_MSG_ITEMS) ?
+		queue->hdr.nitems : 0;
+}
+
+static bool
+rumBuildQueueNextKey(RumBuildStream * stream)
+{
+	RumBuildQueue *queue = (RumBuildQueue *) stream;
+	MemoryContext oldCtx;
+	bool		keyIsNull;
+
+	/* The items are read, so the last message starts a key or ends */
+	if (queue->hdr.type == RUM_BUILD_MSG_END)
+		return false;
+	if (queue->hdr.type != RUM_BUILD_MSG_KEY)
+		elog(ERROR, "unexpected message type %d from parallel worker",
+			 (int) queue->hdr.type);
+
+	MemoryContextReset(queue->keyCtx);
+	oldCtx = MemoryContextSwitchTo(queue->keyCtx);
+	stream->key = datumRestore(&queue->data, &keyIsNull);
+	MemoryContextSwitchTo(oldCtx);
+
+	stream->attnum = queue->hdr.attnum;
+	stream->category = queue->hdr.category;
+
+	rumBuildQueueReceive(queue);
+
+	return true;
+}
+
+static uint32
+rumBuildQueueReadItems(RumBuildStream * stream, RumItem * items,
+					   uint32 maxitems)
+{
+	RumBuildQueue *queue = (RumBuildQueue *) stream;
+	uint32		n = 0;
+	MemoryContext oldCtx;
+
+	MemoryContextReset(queue->itemsCtx);
+	oldCtx = MemoryContextSwitchTo(queue->itemsCtx);
+	while (n < maxitems)
+	{
+		if (queue->nleft == 0)
+		{
+			/* stop at the next key */
+			if (queue->hdr.type != RUM_BUILD_MSG_ITEMS)
+				break;
+			rumBuildQueueReceive(queue);
+			continue;
+		}
+
+		memcpy(&items[n].iptr, queue->data, sizeof(ItemPointerData));
+		queue->data += sizeof(ItemPointerData);
+		items[n].addInfo = datumRestore(&queue->data,
+										&items[n].addInfoIsNull);
+		queue->nleft--;
+		n++;
+	}
+	MemoryContextSwitchTo(oldCtx);
+
+	return n;
+}
+
+static RumBuildStream *
+rumBuildQueueBegin(RumState * rumstate, shm_mq_handle *mqh)
+{
+	RumBuildQueue *queue = (RumBuildQueue *) palloc0(sizeof(RumBuildQueue));
+
+	queue->stream.nextKey = rumBuildQueueNextKey;
+	queue->stream.readItems = rumBuildQueueReadItems;
+	queue->stream.rumstate = rumstate;
+	queue->mqh = mqh;
+	queue->keyCtx = RumContextCreate(CurrentMemoryContext,
+									 "Rum build queue key context");
+	queue->itemsCtx = RumContextCreate(CurrentMemoryContext,
+									   "Rum build queue items context");
+
+	/* Wait for the first key of the worker */
+	rumBuildQueueReceive(queue);
+
+	return &queue->stream;
+}
+
+/* binaryheap is a max-heap, so the comparators are inverted */
+static int
+rumBuildMergeCompareKeys(Datum a, Datum b, void *arg)
+{
+	RumBuildMerge *merge = (RumBuildMerge *) arg;
+	RumBuildStream *sa = merge->children[DatumGetInt32(a)];
+	RumBuildStream *sb = merge->children[DatumGetInt32(b)];
+
+	return -rumCompareAttEntries(merge->stream.rumstate,
+								 sa->attnum, sa->key, sa->category,
+								 sb->attnum, sb->key, sb->category);
+}
+
+static int
+rumBuildMergeCompareItems(Datum a, Datum b, void *arg)
+{
+	RumBuildMerge *merge = (RumBuildMerge *) arg;
+	int			ia = DatumGetInt32(a),
+				ib = DatumGetInt32(b);
+
+	return -compareRumItem(merge->stream.rumstate, merge->stream.attnum,
+						   &merge->buffers[ia][merge->pos[ia]],
+						   &merge->buffers[ib][merge->pos[ib]]);
+}
+
+static bool
+rumBuildMergeNextKey(RumBuildStream * stream)
+{
+	RumBuildMerge *merge = (RumBuildMerge *) stream;
+	RumBuildStream *child;
+	int			first,
+				i;
+
+	/* The children of the previous key are read, move them forward */
+	for (i = 0; i < merge->ncurrent; i++)
+	{
+		child = merge->children[merge->current[i]];
+		if (child->nextKey(child))
+			binaryheap_add(merge->keyHeap, Int32GetDatum(merge->current[i]));
+	}
+	merge->ncurrent = 0;
+
+	if (binaryheap_empty(merge->keyHeap))
+		return false;
+
+	/* Take all the children positioned at the smallest key */
+	first = DatumGetInt32(binaryheap_remove_first(merge->keyHeap));
+	merge->current[merge->ncurrent++] = first;
+	while (!binaryheap_empty(merge->keyHeap) &&
+		   rumBuildMergeCompareKeys(binaryheap_first(merge->keyHeap),
+									Int32GetDatum(first), merge) == 0)
+		merge->current[merge->ncurrent++] =
+			DatumGetInt32(binaryheap_remove_first(merge->keyHeap));
+
+	for (i = 0; i < merge->ncurrent; i++)
+	{
+		merge->nbuffered[merge->current[i]] = 0;
+		merge->pos[merge->current[i]] = 0;
+		merge->finished[merge->current[i]] = false;
+	}
+
+	child = merge->children[first];
+	stream->attnum = child->attnum;
+	stream->key = child->key;
+	stream->category = child->category;
+
+	return true;
+}
+
+static uint32
+rumBuildMergeReadItems(RumBuildStream * stream, RumItem * items,
+					   uint32 maxitems)
+{
+	RumBuildMerge *merge = (RumBuildMerge *) stream;
+	uint32		n = 0;
+	int			i;
+
+	/* The only child has nothing to merge with */
+	if (merge->ncurrent == 1)
+	{
+		RumBuildStream *child = merge->children[merge->current[0]];
+
+		return child->readItems(child, items, maxitems);
+	}
+
+	/*
+	 * Refill the exhausted buffers.  This invalidates the items they returned
+	 * last time, so the loop below stops as soon as a buffer is exhausted.
+	 */
+	binaryheap_reset(merge->itemHeap);
+	for (i = 0; i < merge->ncurrent; i++)
+	{
+		int			c = merge->current[i];
+
+		if (merge->finished[c])
+			continue;
+
+		if (merge->pos[c] == merge->nbuffered[c])
+		{
+			RumBuildStream *child = merge->children[c];
+
+			merge->nbuffered[c] = child->readItems(child, merge->buffers[c],
+												   RUM_BUILD_READ_ITEMS);
+			merge->pos[c] = 0;
+			if (merge->nbuffered[c] == 0)
+			{
+				merge->finished[c] = true;
+				continue;
+			}
+		}
+
+		binaryheap_add_unordered(merge->itemHeap, Int32GetDatum(c));
+	}
+	binaryheap_build(merge->itemHeap);
+
+	while (n < maxitems && !binaryheap_empty(merge->itemHeap))
+	{
+		int			c = DatumGetInt32(binaryheap_first(merge->itemHeap));
+
+		items[n++] = merge->buffers[c][merge->pos[c]++];
+		if (merge->pos[c] == merge->nbuffered[c])
+			break;
+		binaryheap_replace_first(merge->itemHeap, Int32GetDatum(c));
+	}
+
+	return n;
+}
+
+static RumBuildStream *
+rumBuildMergeBegin(RumState * rumstate, RumBuildStream **children,
+				   int nchildren)
+{
+	RumBuildMerge *merge = (RumBuildMerge *) palloc0(sizeof(RumBuildMerge));
+	int			i;
+
+	merge->stream.nextKey = rumBuildMergeNextKey;
+	merge->stream.readItems = rumBuildMergeReadItems;
+	merge->stream.rumstate = rumstate;
+	merge->nchildren = nchildren;
+	merge->children = children;
+	merge->keyHeap = binaryheap_allocate(nchildren, rumBuildMergeCompareKeys,
+										 merge);
+	merge->current = (int *) palloc(sizeof(int) * nchildren);
+	merge->itemHeap = binaryheap_allocate(nchildren,
+										  rumBuildMergeCompareItems, merge);
+	merge->buffers = (RumItem **) palloc(sizeof(RumItem *) * nchildren);
+	merge->nbuffered = (uint32 *) palloc0(sizeof(uint32) * nchildren);
+	merge->pos = (uint32 *) palloc0(sizeof(uint32) * nchildren);
+	merge->finished = (bool *) palloc0(sizeof(bool) * nchildren);
+
+	for (i = 0; i < nchildren; i++)
+	{
+		merge->buffers[i] = (RumItem *) palloc(sizeof(RumItem) *
+											   RUM_BUILD_READ_ITEMS);
+		if (children[i]->nextKey(children[i]))
+			binaryheap_add_unordered(merge->keyHeap, Int32GetDatum(i));
+	}
+	binaryheap_build(merge->keyHeap);
+
+	return &merge->stream;
+}
+
+/*
+ * Begin the merge of the runs of this participant and the given streams.
+ */
+static RumBuildStream *
+rumBuildMergeRuns(RumBuildState * buildstate, RumBuildStream **streams,
+				  int nstreams)
+{
+	RumBuildStream **children;
+	int			nchildren = nstreams;
+	ListCell   *lc;
+
+	children = (RumBuildStream **) palloc(sizeof(RumBuildStream *) *
+										  (nstreams + list_length(buildstate->runs)));
+	if (nstreams > 0)
+		memcpy(children, streams, sizeof(RumBuildStream *) * nstreams);
+	foreach(lc, buildstate->runs)
+		children[nchildren++] = rumBuildRunBegin(&buildstate->rumstate,
+												 (BufFile *) lfirst(lc));
+
+	return rumBuildMergeBegin(&buildstate->rumstate, children, nchildren);
+}
+
+static void
+rumParallelSend(shm_mq_handle *mqh, void *data, Size nbytes, bool flush)
+{
+	shm_mq_result res;
+
+#if PG_VERSION_NUM >= 150000
+	res = shm_mq_send(mqh, nbytes, data, false, flush);
+#else
+	res = shm_mq_send(mqh, nbytes, data, false);
+#endif
+
+	if (res != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not send RUM index entries to the leader")));
+}
+
+/*
+ * Send items of the current key to the leader, splitting them into several
+ * messages if needed.
+ */
+static void
+rumParallelSendItems(shm_mq_handle *mqh, Form_pg_attribute addAttr,
+					 RumItem * items, uint32 nitems)
+{
+	bool		addByVal = addAttr ? addAttr->attbyval : true;
+	int			addLen = addAttr ? addAttr->attlen : sizeof(Datum);
+	uint32		i = 0;
+
+	while (i < nitems)
+	{
+		RumBuildMessageHeader hdr;
+		uint32		first = i,
+					j;
+		Size		size = sizeof(hdr);
+		char	   *buffer,
+				   *ptr;
+
+		for (; i < nitems; i++)
+		{
+			Size		itemSize = sizeof(ItemPointerData) +
+				datumEstimateSpace(items[i].addInfo, items[i].addInfoIsNull,
+								   addByVal, addLen);
+
+			if (i > first && size + itemSize > RUM_PARALLEL_MESSAGE_SIZE)
+				break;
+			size += itemSize;
+		}
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.type = RUM_BUILD_MSG_ITEMS;
+		hdr.nitems = i - first;
+
+		ptr = buffer = palloc(size);
+		memcpy(ptr, &hdr, sizeof(hdr));
+		ptr += sizeof(hdr);
+		for (j = first; j < i; j++)
+		{
+			memcpy(ptr, &items[j].iptr, sizeof(ItemPointerData));
+			ptr += sizeof(ItemPointerData);
+			datumSerialize(items[j].addInfo, items[j].addInfoIsNull,
+						   addByVal, addLen, &ptr);
+		}
+		Assert(ptr == buffer + size);
+
+		rumParallelSend(mqh, buffer, size, false);
+		pfree(buffer);
+	}
+}
+
+/*
+ * Send the merged stream of a worker to the leader.
+ */
+static void
+rumParallelSendStream(RumState * rumstate, shm_mq_handle *mqh,
+					  RumBuildStream * stream)
+{
+	RumBuildMessageHeader hdr;
+	RumItem    *items;
+	uint32		nitems;
+
+	items = (RumItem *) palloc(sizeof(RumItem) * RUM_BUILD_READ_ITEMS);
+
+	while (stream->nextKey(stream))
+	{
+		Form_pg_attribute keyAttr = RumTupleDescAttr(rumstate->origTupdesc,
+													 stream->attnum - 1);
+		bool		keyIsNull = (stream->category != RUM_CAT_NORM_KEY);
+		Size		size;
+		char	   *buffer,
+				   *ptr;
+
+		CHECK_FOR_INTERRUPTS();
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.type = RUM_BUILD_MSG_KEY;
+		hdr.attnum = stream->attnum;
+		hdr.category = stream->category;
+
+		size = sizeof(hdr) + datumEstimateSpace(stream->key, keyIsNull,
+												keyAttr->attbyval,
+												keyAttr->attlen);
+		ptr = buffer = palloc(size);
+		memcpy(ptr, &hdr, sizeof(hdr));
+		ptr += sizeof(hdr);
+		datumSerialize(stream->key, keyIsNull,
+					   keyAttr->attbyval, keyAttr->attlen, &ptr);
+		rumParallelSend(mqh, buffer, size, false);
+		pfree(buffer);
+
+		while ((nitems = stream->readItems(stream, items,
+										   RUM_BUILD_READ_ITEMS)) > 0)
+			rumParallelSendItems(mqh, rumstate->addAttrs[stream->attnum - 1],
+								 items, nitems);
+	}
+
+	/* tell the leader that we are done */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.type = RUM_BUILD_MSG_END;
+	rumParallelSend(mqh, &hdr, sizeof(hdr), true);
+
+	pfree(items);
+}
+
+/*
+ * Insert the merged stream into the index.  All items of a key are collected
+ * to be inserted at once, unless they exceed maintenance_work_mem.
+ */
+static void
+rumParallelInsertStream(RumBuildState * buildstate, RumBuildStream * stream)
+{
+	RumState   *rumstate = &buildstate->rumstate;
+	Size		maxitems;
+	uint32		allocated = RUM_BUILD_READ_ITEMS;
+	RumItem    *items;
+	BlockNumber leafHint = InvalidBlockNumber;
+	MemoryContext oldCtx;
+
+	maxitems = Min((Size) maintenance_work_mem * 1024L, MaxAllocSize) /
+		sizeof(RumItem);
+	items = (RumItem *) palloc(sizeof(RumItem) * allocated);
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	while (stream->nextKey(stream))
+	{
+		Form_pg_attribute addAttr = rumstate->addAttrs[stream->attnum - 1];
+		uint32		nitems = 0,
+					n,
+					i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (;;)
+		{
+			if (allocated - nitems < RUM_BUILD_READ_ITEMS)
+			{
+				if ((Size) allocated * 2 <= maxitems)
+				{
+					allocated *= 2;
+					items = (RumItem *) repalloc(items,
+												 sizeof(RumItem) * allocated);
+				}
+				else
+				{
+					/* insert the collected part, the rest will follow */
+					rumEntryInsert(rumstate, stream->attnum, stream->key,
+								   stream->category, items, nitems,
+								   &buildstate->buildStats, &leafHint);
+					MemoryContextReset(buildstate->tmpCtx);
+					nitems = 0;
+				}
+			}
+
+			n = stream->readItems(stream, items + nitems,
+								  RUM_BUILD_READ_ITEMS);
+			if (n == 0)
+				break;
+
+			/* The stream overwrites addInfo on the next read */
+			if (addAttr && !addAttr->attbyval)
+			{
+				for (i = nitems; i < nitems + n; i++)
+					if (!items[i].addInfoIsNull)
+						items[i].addInfo = datumCopy(items[i].addInfo, false,
+													 addAttr->attlen);
+			}
+			nitems += n;
+		}
+
+		if (nitems > 0)
+			rumEntryInsert(rumstate, stream->attnum, stream->key,
+						   stream->category, items, nitems,
+						   &buildstate->buildStats, &leafHint);
+		MemoryContextReset(buildstate->tmpCtx);
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	pfree(items);
+}
+#endif
+
+/*
+ * Dump all entries of the build accumulator to the index, or to a sorted run
+ * in a parallel build.
+ */
+static void
+rumFlushBuildState(RumBuildState * buildstate)
+{
+	RumItem    *items;
+	Datum		key;
+	RumNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+	BlockNumber leafHint = InvalidBlockNumber;
+
+#ifdef RUM_PARALLEL_BUILD
+	if (buildstate->writeRuns)
+	{
+		rumBuildWriteRun(buildstate);
+		return;
+	}
+#endif
+
+	rumBeginBAScan(&buildstate->accum);
+	while ((items = rumGetBAEntry(&buildstate->accum,
+								  &attnum, &key, &category, &nlist)) != NULL)
+	{
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+		rumEntryInsert(&buildstate->rumstate, attnum, key, category,
+					   items, nlist, &buildstate->buildStats, &leafHint);
+	}
+}
+
+static void
+rumBuildCallback(Relation index,
+#if PG_VERSION_NUM < 130000
+				 HeapTuple htup,
+#else
+				 ItemPointer tid,
+#endif
+				 Datum *values,
+				 bool *isnull, bool tupleIsAlive, void *state)
+{
+	RumBuildState *buildstate = (RumBuildState *) state;
+	MemoryContext oldCtx;
+	int			i;
+	Datum		outerAddInfo = (Datum) 0;
+	bool		outerAddInfoIsNull = true;
+#if PG_VERSION_NUM < 130000
+	ItemPointer tid = &htup->t_self;
+#endif
+
+	if (AttributeNumberIsValid(buildstate->rumstate.attrnAttachColumn))
+	{
+		outerAddInfo = values[buildstate->rumstate.attrnAttachColumn - 1];
+		outerAddInfoIsNull = isnull[buildstate->rumstate.attrnAttachColumn - 1];
+	}
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	for (i = 0; i < buildstate->rumstate.origTupdesc->natts; i++)
 		rumHeapTupleBulkInsert(buildstate, (OffsetNumber) (i + 1),
 							   values[i], isnull[i],
 							   tid,
 							   outerAddInfo, outerAddInfoIsNull);
 
-	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= maintenance_work_mem * 1024L)
+	/* If we've maxed out our available memory, dump everything to the index */
+	if (buildstate->accum.allocatedMemory >= buildstate->workMem * 1024L)
+	{
+		rumFlushBuildState(buildstate);
+
+		MemoryContextReset(buildstate->tmpCtx);
+		rumInitBA(&buildstate->accum);
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
+static void
+rumInitBuildState(RumBuildState * buildstate, Relation index, int workMem)
+{
+	initRumState(&buildstate->rumstate, index);
+	buildstate->rumstate.isBuild = true;
+	buildstate->indtuples = 0;
+	memset(&buildstate->buildStats, 0, sizeof(GinStatsData));
+	buildstate->workMem = workMem;
+#ifdef RUM_PARALLEL_BUILD
+	buildstate->writeRuns = false;
+	buildstate->runs = NIL;
+	buildstate->runsCtx = CurrentMemoryContext;
+#endif
+
+	/*
+	 * create a temporary memory context that is reset once for each tuple
+	 * inserted into the index
+	 */
+	buildstate->tmpCtx = RumContextCreate(CurrentMemoryContext,
+										  "Rum build temporary context");
+
+	buildstate->funcCtx = RumContextCreate(CurrentMemoryContext,
+					 "Rum build temporary context for user-defined function");
+
+	buildstate->accum.rumstate = &buildstate->rumstate;
+	rumInitBA(&buildstate->accum);
+}
+
+#ifdef RUM_PARALLEL_BUILD
+/*
+ * Number of parallel workers to be used for the index build.
+ */
+static int
+rumBuildWorkers(Relation heap, Relation index, IndexInfo *indexInfo)
+{
+#if PG_VERSION_NUM >= 170000
+	/* index_build() plans workers, since amcanbuildparallel is set */
+	return indexInfo->ii_ParallelWorkers;
+#else
+	if (!IsNormalProcessingMode() || IsInParallelMode())
+		return 0;
+
+	return plan_create_index_workers(RelationGetRelid(heap),
+									 RelationGetRelid(index));
+#endif
+}
+
+/*
+ * Scan the share of the heap of a participant, writing its entries to
+ * sorted runs.
+ */
+static void
+rumParallelScan(RumBuildState * buildstate, RumBuildShared * shared,
+				Relation heap, Relation index, IndexInfo *indexInfo)
+{
+	TableScanDesc scan;
+	double		reltuples;
+	MemoryContext oldCtx;
+
+	buildstate->writeRuns = true;
+
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromRumBuildShared(shared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, false,
+									   rumBuildCallback, (void *) buildstate,
+									   scan);
+
+	/* write the remaining entries */
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+	rumFlushBuildState(buildstate);
+	MemoryContextSwitchTo(oldCtx);
+
+	MemoryContextReset(buildstate->tmpCtx);
+	rumInitBA(&buildstate->accum);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->reltuples += reltuples;
+	shared->indtuples += buildstate->indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		shared->brokenhotchain = true;
+	SpinLockRelease(&shared->mutex);
+}
+
+/*
+ * Try to build the index using parallel workers.  Returns false if no
+ * workers could be launched, then the caller should do the serial build.
+ */
+static bool
+rumBuildParallel(RumBuildState * buildstate, Relation heap, Relation index,
+				 IndexInfo *indexInfo, int nworkers, double *reltuples)
+{
+	ParallelContext *pcxt;
+	Snapshot	snapshot;
+	Size		estshared;
+	RumBuildShared *shared;
+	char	   *queues;
+	RumBuildStream **streams;
+	int			nparticipants,
+				i;
+	bool		isconcurrent = indexInfo->ii_Concurrent;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("rum", "_rum_parallel_build_main", nworkers);
+
+	/*
+	 * Prepare the snapshot for the heap scan like nbtree does: SnapshotAny
+	 * for a regular build and an MVCC snapshot for a concurrent one.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	estshared = add_size(BUFFERALIGN(sizeof(RumBuildShared)),
+						 table_parallelscan_estimate(heap, snapshot));
+	shm_toc_estimate_chunk(&pcxt->estimator, estshared);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(RUM_PARALLEL_QUEUE_SIZE, nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	InitializeParallelDSM(pcxt);
+
+	/* If there's no DSM available, fall back to the serial build */
+	if (pcxt->seg == NULL)
+		goto fail;
+
+	shared = (RumBuildShared *) shm_toc_allocate(pcxt->toc, estshared);
+	shared->heaprelid = RelationGetRelid(heap);
+	shared->indexrelid = RelationGetRelid(index);
+	shared->isconcurrent = isconcurrent;
+	ConditionVariableInit(&shared->workMemCV);
+	SpinLockInit(&shared->mutex);
+	shared->workMem = 0;
+	shared->reltuples = 0.0;
+	shared->indtuples = 0.0;
+	shared->brokenhotchain = false;
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromRumBuildShared(shared),
+								  snapshot);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_RUM_SHARED, shared);
+
+	queues = shm_toc_allocate(pcxt->toc,
+							  mul_size(RUM_PARALLEL_QUEUE_SIZE, nworkers));
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queues + i * RUM_PARALLEL_QUEUE_SIZE,
+						   RUM_PARALLEL_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_RUM_QUEUES, queues);
+
+	LaunchParallelWorkers(pcxt);
+
+	if (pcxt->nworkers_launched == 0)
+	{
+		WaitForParallelWorkersToFinish(pcxt);
+		goto fail;
+	}
+
+	ereport(DEBUG1,
+			(errmsg_internal("building RUM index \"%s\" in parallel with %d workers requested",
+							 RelationGetRelationName(index), nworkers)));
+
+	/* Share maintenance_work_mem between the launched participants */
+	nparticipants = pcxt->nworkers_launched +
+		(parallel_leader_participation ? 1 : 0);
+	buildstate->workMem = Max(maintenance_work_mem / nparticipants, 64);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->workMem = buildstate->workMem;
+	SpinLockRelease(&shared->mutex);
+	ConditionVariableBroadcast(&shared->workMemCV);
+
+	if (parallel_leader_participation)
+		rumParallelScan(buildstate, shared, heap, index, indexInfo);
+
+	/* Merge the streams of the workers with the runs of the leader */
+	streams = (RumBuildStream **) palloc(sizeof(RumBuildStream *) *
+										 pcxt->nworkers_launched);
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+	{
+		shm_mq_handle *mqh;
+
+		mqh = shm_mq_attach((shm_mq *) (queues + i * RUM_PARALLEL_QUEUE_SIZE),
+							pcxt->seg, pcxt->worker[i].bgwhandle);
+		streams[i] = rumBuildQueueBegin(&buildstate->rumstate, mqh);
+	}
+
+	rumParallelInsertStream(buildstate,
+							rumBuildMergeRuns(buildstate, streams,
+											  pcxt->nworkers_launched));
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	*reltuples = shared->reltuples;
+	buildstate->indtuples = shared->indtuples;
+	if (shared->brokenhotchain)
+		indexInfo->ii_BrokenHotChain = true;
+
+	if (IsMVCCSnapshot(snapshot))
+		UnregisterSnapshot(snapshot);
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+
+fail:
+	if (IsMVCCSnapshot(snapshot))
+		UnregisterSnapshot(snapshot);
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return false;
+}
+
+/*
+ * Entry point of a parallel build worker.
+ */
+void
+_rum_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	RumBuildShared *shared;
+	char	   *queues;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	RumBuildState buildstate;
+	Relation	heap,
+				index;
+	LOCKMODE	heapLockmode,
+				indexLockmode;
+	IndexInfo  *indexInfo;
+	int			workMem;
+
+	shared = (RumBuildShared *) shm_toc_lookup(toc, PARALLEL_KEY_RUM_SHARED,
+											   false);
+
+	/* Open relations using lock modes known to be obtained by the leader */
+	if (!shared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	heap = table_open(shared->heaprelid, heapLockmode);
+	index = index_open(shared->indexrelid, indexLockmode);
+
+	queues = (char *) shm_toc_lookup(toc, PARALLEL_KEY_RUM_QUEUES, false);
+	mq = (shm_mq *) (queues + ParallelWorkerNumber * RUM_PARALLEL_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Wait until the leader knows how many workers are launched */
+	for (;;)
+	{
+		SpinLockAcquire(&shared->mutex);
+		workMem = shared->workMem;
+		SpinLockRelease(&shared->mutex);
+
+		if (workMem > 0)
+			break;
+		ConditionVariableSleep(&shared->workMemCV, PG_WAIT_EXTENSION);
+	}
+	ConditionVariableCancelSleep();
+
+	rumInitBuildState(&buildstate, index, workMem);
+
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = shared->isconcurrent;
+
+	rumParallelScan(&buildstate, shared, heap, index, indexInfo);
+
+	/* Merge the runs and send them to the leader */
+	rumParallelSendStream(&buildstate.rumstate, mqh,
+						  rumBuildMergeRuns(&buildstate, NULL, 0));
+	shm_mq_detach(mqh);
+
+	index_close(index, indexLockmode);
+	table_close(heap, heapLockmode);
+}
+#endif
+
+#ifdef RUM_INSERT_BUFFER
+bool		RumInsertBuffer = false;
+
+/*
+ * Entries of the rows inserted into an index by the current transaction,
+ * which are not added to the index yet.  They are accumulated the same way
+ * as during index build and then added in key order, so every key descends
+ * the entry tree and its posting tree once per flush instead of once per
+ * row.  The buffer is flushed when it exceeds work_mem, at the end of
+ * statement, when the index is scanned by this backend and at commit at the
+ * latest.
+ *
+ * Buffers live in TopTransactionContext.  A buffer holds entries of a single
+ * subtransaction, so that they can be thrown away if it aborts.
+ */
+typedef struct RumPendingInserts
+{
+	Oid			indexOid;
+	SubTransactionId subid;		/* subtransaction the entries belong to */
+	MemoryContext accumCtx;		/* holds the accumulator and its entries */
+	BuildAccumulator accum;
+	bool		isEmpty;
+	struct RumPendingInserts *next;
+}	RumPendingInserts;
+
+static RumPendingInserts *pendingInserts = NULL;
+static bool pendingInsertsCallbacksRegistered = false;
+static ExecutorStart_hook_type prevExecutorStart = NULL;
+
+/*
+ * Add buffered entries to the index and empty the buffer.  rumstate may be
+ * NULL, then it's initialized here.
+ *
+ * If an error occurs in the middle, the buffer is kept and entries added so
+ * far are added again by the next flush, which is harmless since duplicate
+ * items are merged.
+ */
+static void
+pendingInsertsFlush(RumPendingInserts * pending, Relation index,
+					RumState * rumstate)
+{
+	MemoryContext flushCtx,
+				oldCtx;
+	RumItem    *items;
+	Datum		key;
+	RumNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+	BlockNumber leafHint = InvalidBlockNumber;
+
+	if (pending->isEmpty)
+		return;
+
+	flushCtx = RumContextCreate(CurrentMemoryContext,
+								"Rum insert buffer flush context");
+	oldCtx = MemoryContextSwitchTo(flushCtx);
+
+	if (rumstate == NULL)
 	{
-		RumItem	   *items;
-		Datum		key;
-		RumNullCategory category;
-		uint32		nlist;
-		OffsetNumber attnum;
+		rumstate = (RumState *) palloc(sizeof(RumState));
+		initRumState(rumstate, index);
+	}
+	pending->accum.rumstate = rumstate;
 
-		rumBeginBAScan(&buildstate->accum);
-		while ((items = rumGetBAEntry(&buildstate->accum,
+	rumBeginBAScan(&pending->accum);
+	while ((items = rumGetBAEntry(&pending->accum,
 								  &attnum, &key, &category, &nlist)) != NULL)
+	{
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+		rumEntryInsert(rumstate, attnum, key, category,
+					   items, nlist, NULL, &leafHint);
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextDelete(flushCtx);
+
+	/* start over with an empty accumulator */
+	MemoryContextReset(pending->accumCtx);
+	oldCtx = MemoryContextSwitchTo(pending->accumCtx);
+	rumInitBA(&pending->accum);
+	MemoryContextSwitchTo(oldCtx);
+	pending->isEmpty = true;
+}
+
+static RumPendingInserts *
+pendingInsertsFind(Oid indexOid)
+{
+	RumPendingInserts *pending;
+
+	for (pending = pendingInserts; pending != NULL; pending = pending->next)
+	{
+		if (pending->indexOid == indexOid)
+			return pending;
+	}
+
+	return NULL;
+}
+
+/*
+ * Forget the buffers matching the given index or subtransaction.
+ */
+static void
+pendingInsertsDiscard(Oid indexOid, SubTransactionId subid)
+{
+	RumPendingInserts **prev = &pendingInserts;
+	RumPendingInserts *pending;
+
+	while ((pending = *prev) != NULL)
+	{
+		if (pending->indexOid == indexOid || pending->subid == subid)
 		{
-			/* there could be many entries, so be willing to abort here */
-			CHECK_FOR_INTERRUPTS();
-			rumEntryInsert(&buildstate->rumstate, attnum, key, category,
-						   items, nlist, &buildstate->buildStats);
+			*prev = pending->next;
+			MemoryContextDelete(pending->accumCtx);
+			pfree(pending);
 		}
+		else
+			prev = &pending->next;
+	}
+}
 
-		MemoryContextReset(buildstate->tmpCtx);
-		rumInitBA(&buildstate->accum);
+/*
+ * Flush the buffers of all the indexes.
+ */
+static void
+pendingInsertsFlushAll(void)
+{
+	RumPendingInserts *pending;
+
+	for (pending = pendingInserts; pending != NULL; pending = pending->next)
+	{
+		Relation	index;
+
+		if (pending->isEmpty)
+			continue;
+
+		index = try_relation_open(pending->indexOid, RowExclusiveLock);
+		if (index == NULL)
+			continue;
+		pendingInsertsFlush(pending, index, NULL);
+		relation_close(index, NoLock);
+	}
+}
+
+static void
+pendingInsertsXactCallback(XactEvent event, void *arg)
+{
+
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			/* normally buffers are already flushed at the end of statement */
+			pendingInsertsFlushAll();
+			break;
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			/* buffers are freed along with TopTransactionContext */
+			pendingInserts = NULL;
+			break;
+		default:
+			break;
+	}
+}
+
+static void
+pendingInsertsSubXactCallback(SubXactEvent event, SubTransactionId mySubid,
+							  SubTransactionId parentSubid, void *arg)
+{
+	RumPendingInserts *pending;
+
+	switch (event)
+	{
+		case SUBXACT_EVENT_COMMIT_SUB:
+			for (pending = pendingInserts; pending != NULL;
+				 pending = pending->next)
+			{
+				if (pending->subid == mySubid)
+					pending->subid = parentSubid;
+			}
+			break;
+		case SUBXACT_EVENT_ABORT_SUB:
+			/* rows of the aborted subtransaction are dead */
+			pendingInsertsDiscard(InvalidOid, mySubid);
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * Get the insert buffer of the index for the current subtransaction.
+ */
+static RumPendingInserts *
+pendingInsertsGet(Relation index, RumState * rumstate)
+{
+	SubTransactionId subid = GetCurrentSubTransactionId();
+	RumPendingInserts *pending;
+	MemoryContext oldCtx;
+
+	pending = pendingInsertsFind(RelationGetRelid(index));
+	if (pending != NULL)
+	{
+		if (pending->subid != subid)
+		{
+			/* don't mix entries of different subtransactions */
+			pendingInsertsFlush(pending, index, rumstate);
+			pending->subid = subid;
+		}
+		return pending;
+	}
+
+	if (!pendingInsertsCallbacksRegistered)
+	{
+		RegisterXactCallback(pendingInsertsXactCallback, NULL);
+		RegisterSubXactCallback(pendingInsertsSubXactCallback, NULL);
+		pendingInsertsCallbacksRegistered = true;
+	}
+
+	pending = (RumPendingInserts *)
+		MemoryContextAllocZero(TopTransactionContext,
+							   sizeof(RumPendingInserts));
+	pending->indexOid = RelationGetRelid(index);
+	pending->subid = subid;
+	pending->accumCtx = RumContextCreate(TopTransactionContext,
+										 "Rum insert buffer");
+	oldCtx = MemoryContextSwitchTo(pending->accumCtx);
+	pending->accum.rumstate = rumstate;
+	rumInitBA(&pending->accum);
+	MemoryContextSwitchTo(oldCtx);
+	pending->isEmpty = true;
+
+	pending->next = pendingInserts;
+	pendingInserts = pending;
+
+	return pending;
+}
+
+/*
+ * Extract index entries for a single indexable item and add them to the
+ * insert buffer.  Like rumHeapTupleBulkInsert(), but the memory for
+ * extraction is the caller's one.
+ */
+static void
+rumHeapTupleBufferInsert(RumState * rumstate, RumPendingInserts * pending,
+						 OffsetNumber attnum, Datum value, bool isNull,
+						 ItemPointer item,
+						 Datum outerAddInfo,
+						 bool outerAddInfoIsNull)
+{
+	Datum	   *entries;
+	RumNullCategory *categories;
+	int32		i,
+				nentries;
+	Datum	   *addInfo;
+	bool	   *addInfoIsNull;
+	Form_pg_attribute attr = rumstate->addAttrs[attnum - 1];
+	MemoryContext oldCtx;
+
+	entries = rumExtractEntries(rumstate, attnum, value, isNull,
+						   &nentries, &categories, &addInfo, &addInfoIsNull);
+
+	if (attnum == rumstate->attrnAddToColumn)
+	{
+		addInfo = palloc(sizeof(*addInfo) * nentries);
+		addInfoIsNull = palloc(sizeof(*addInfoIsNull) * nentries);
+
+		for (i = 0; i < nentries; i++)
+		{
+			addInfo[i] = outerAddInfo;
+			addInfoIsNull[i] = outerAddInfoIsNull;
+		}
+	}
+
+	oldCtx = MemoryContextSwitchTo(pending->accumCtx);
+
+	for (i = 0; i < nentries; i++)
+	{
+		if (!addInfoIsNull[i])
+		{
+			/* Check existance of additional information attribute in index */
+			if (!attr)
+			{
+				Form_pg_attribute current_attr = RumTupleDescAttr(
+					rumstate->origTupdesc, attnum - 1);
+
+				elog(ERROR, "additional information attribute \"%s\" is not found in index",
+					 NameStr(current_attr->attname));
+			}
+
+			addInfo[i] = datumCopy(addInfo[i], attr->attbyval, attr->attlen);
+		}
 	}
 
+	pending->accum.rumstate = rumstate;
+	rumInsertBAEntries(&pending->accum, item, attnum,
+					   entries, addInfo, addInfoIsNull, categories, nentries);
+
 	MemoryContextSwitchTo(oldCtx);
+
+	if (nentries > 0)
+		pending->isEmpty = false;
 }
+#endif
 
 IndexBuildResult *
 rumbuild(Relation heap, Relation index, struct IndexInfo *indexInfo)
 {
 	IndexBuildResult *result;
-	double		reltuples;
+	double		reltuples = 0;
 	RumBuildState buildstate;
 	Buffer		RootBuffer,
 				MetaBuffer;
-	RumItem	   *items;
-	Datum		key;
-	RumNullCategory category;
-	uint32		nlist;
 	MemoryContext oldCtx;
-	OffsetNumber attnum;
+#if PG_VERSION_NUM < 120000
 	BlockNumber	blkno;
+#endif
+	bool		parallel = false;
 
 	if (RelationGetNumberOfBlocks(index) != 0)
 		elog(ERROR, "index \"%s\" already contains data",
 			 RelationGetRelationName(index));
 
-	initRumState(&buildstate.rumstate, index);
-	buildstate.rumstate.isBuild = true;
-	buildstate.indtuples = 0;
-	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+#ifdef RUM_INSERT_BUFFER
+	/*
+	 * The index is rebuilt from the heap, so buffered entries are either
+	 * found by the heap scan or belong to truncated rows.
+	 */
+	pendingInsertsDiscard(RelationGetRelid(index), InvalidSubTransactionId);
+#endif
+
+	rumInitBuildState(&buildstate, index, maintenance_work_mem);
 
 	/* initialize the meta page */
 	MetaBuffer = RumNewBuffer(index);
@@ -651,38 +2466,30 @@ rumbuild(Relation heap, Relation index, struct IndexInfo *indexInfo)
 	/* count the root as first entry page */
 	buildstate.buildStats.nEntryPages++;
 
-	/*
-	 * create a temporary memory context that is reset once for each tuple
-	 * inserted into the index
-	 */
-	buildstate.tmpCtx = RumContextCreate(CurrentMemoryContext,
-										 "Rum build temporary context");
-
-	buildstate.funcCtx = RumContextCreate(CurrentMemoryContext,
-					 "Rum build temporary context for user-defined function");
-
-	buildstate.accum.rumstate = &buildstate.rumstate;
-	rumInitBA(&buildstate.accum);
+#ifdef RUM_PARALLEL_BUILD
+	{
+		int			nworkers = rumBuildWorkers(heap, index, indexInfo);
 
-	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
-	 */
-	reltuples = IndexBuildHeapScan(heap, index, indexInfo, false,
-								   rumBuildCallback, (void *) &buildstate);
+		if (nworkers > 0)
+			parallel = rumBuildParallel(&buildstate, heap, index, indexInfo,
+										nworkers, &reltuples);
+	}
+#endif
 
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	rumBeginBAScan(&buildstate.accum);
-	while ((items = rumGetBAEntry(&buildstate.accum,
-								  &attnum, &key, &category, &nlist)) != NULL)
+	if (!parallel)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		rumEntryInsert(&buildstate.rumstate, attnum, key, category,
-					   items, nlist, &buildstate.buildStats);
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, false,
+									   rumBuildCallback, (void *) &buildstate);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		rumFlushBuildState(&buildstate);
+		MemoryContextSwitchTo(oldCtx);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -694,23 +2501,35 @@ rumbuild(Relation heap, Relation index, struct IndexInfo *indexInfo)
 	rumUpdateStats(index, &buildstate.buildStats, buildstate.rumstate.isBuild);
 
 	/*
-	 * Write index to xlog
+	 * Write index to xlog.  Pages were built without WAL, so log full images
+	 * of them now, unless the index doesn't need WAL at all: it's unlogged,
+	 * or (since 13) wal_level is minimal and the index was created in this
+	 * transaction, in which case it is synced to disk at commit instead.
 	 */
-	for (blkno = 0; blkno < buildstate.buildStats.nTotalPages; blkno++)
+	if (RelationNeedsWAL(index))
 	{
-		Buffer		buffer;
-		GenericXLogState *state;
+#if PG_VERSION_NUM >= 120000
+		/* Batch many pages into each WAL record */
+		log_newpage_range(index, MAIN_FORKNUM,
+						  0, buildstate.buildStats.nTotalPages, true);
+#else
+		for (blkno = 0; blkno < buildstate.buildStats.nTotalPages; blkno++)
+		{
+			Buffer		buffer;
+			GenericXLogState *state;
 
-		CHECK_FOR_INTERRUPTS();
+			CHECK_FOR_INTERRUPTS();
 
-		buffer = ReadBuffer(index, blkno);
-		LockBuffer(buffer, RUM_EXCLUSIVE);
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, RUM_EXCLUSIVE);
 
-		state = GenericXLogStart(index);
-		GenericXLogRegisterBuffer(state, buffer, GENERIC_XLOG_FULL_IMAGE);
-		GenericXLogFinish(state);
+			state = GenericXLogStart(index);
+			GenericXLogRegisterBuffer(state, buffer, GENERIC_XLOG_FULL_IMAGE);
+			GenericXLogFinish(state);
 
-		UnlockReleaseBuffer(buffer);
+			UnlockReleaseBuffer(buffer);
+		}
+#endif
 	}
 
 	/*
@@ -766,7 +2585,8 @@ rumHeapTupleInsert(RumState * rumstate, OffsetNumber attnum,
 				   Datum value, bool isNull,
 				   ItemPointer item,
 				   Datum outerAddInfo,
-				   bool outerAddInfoIsNull)
+				   bool outerAddInfoIsNull,
+				   BlockNumber *leafHint)
 {
 	Datum	   *entries;
 	RumNullCategory *categories;
@@ -810,7 +2630,7 @@ rumHeapTupleInsert(RumState * rumstate, OffsetNumber attnum,
 		insert_item.addInfoIsNull = addInfoIsNull[i];
 
 		rumEntryInsert(rumstate, attnum, entries[i], categories[i],
-					   &insert_item, 1, NULL);
+					   &insert_item, 1, NULL, leafHint);
 	}
 }
 
@@ -826,33 +2646,142 @@ ruminsert(Relation index, Datum *values, bool *isnull,
 #endif
 		  )
 {
-	RumState	rumstate;
+	RumState   *rumstate;
 	MemoryContext oldCtx;
 	MemoryContext insertCtx;
 	int			i;
 	Datum		outerAddInfo = (Datum) 0;
 	bool		outerAddInfoIsNull = true;
+	BlockNumber leafHint = InvalidBlockNumber;
+#ifdef RUM_INSERT_BUFFER
+	RumPendingInserts *pending = NULL;
+#endif
+
+#if PG_VERSION_NUM >= 100000
+	/* Initialize RumState cache if first call in this statement */
+	rumstate = (RumState *) indexInfo->ii_AmCache;
+	if (rumstate == NULL)
+	{
+		oldCtx = MemoryContextSwitchTo(indexInfo->ii_Context);
+		rumstate = (RumState *) palloc(sizeof(RumState));
+		initRumState(rumstate, index);
+		indexInfo->ii_AmCache = (void *) rumstate;
+		MemoryContextSwitchTo(oldCtx);
+	}
+#endif
 
 	insertCtx = RumContextCreate(CurrentMemoryContext,
 								 "Rum insert temporary context");
 
 	oldCtx = MemoryContextSwitchTo(insertCtx);
 
-	initRumState(&rumstate, index);
+#if PG_VERSION_NUM < 100000
+	rumstate = (RumState *) palloc(sizeof(RumState));
+	initRumState(rumstate, index);
+#endif
 
-	if (AttributeNumberIsValid(rumstate.attrnAttachColumn))
+	if (AttributeNumberIsValid(rumstate->attrnAttachColumn))
 	{
-		outerAddInfo = values[rumstate.attrnAttachColumn - 1];
-		outerAddInfoIsNull = isnull[rumstate.attrnAttachColumn - 1];
+		outerAddInfo = values[rumstate->attrnAttachColumn - 1];
+		outerAddInfoIsNull = isnull[rumstate->attrnAttachColumn - 1];
 	}
 
-	for (i = 0; i < rumstate.origTupdesc->natts; i++)
-		rumHeapTupleInsert(&rumstate, (OffsetNumber) (i + 1),
-						   values[i], isnull[i], ht_ctid,
-						   outerAddInfo, outerAddInfoIsNull);
+#ifdef RUM_INSERT_BUFFER
+	if (RumInsertBuffer)
+		pending = pendingInsertsGet(index, rumstate);
+
+	if (pending != NULL)
+	{
+		for (i = 0; i < rumstate->origTupdesc->natts; i++)
+			rumHeapTupleBufferInsert(rumstate, pending, (OffsetNumber) (i + 1),
+									 values[i], isnull[i], ht_ctid,
+									 outerAddInfo, outerAddInfoIsNull);
+
+		/* If the buffer is full, dump it to the index */
+		if (pending->accum.allocatedMemory >= (Size) work_mem * 1024L)
+			pendingInsertsFlush(pending, index, rumstate);
+	}
+	else
+#endif
+		for (i = 0; i < rumstate->origTupdesc->natts; i++)
+			rumHeapTupleInsert(rumstate, (OffsetNumber) (i + 1),
+							   values[i], isnull[i], ht_ctid,
+							   outerAddInfo, outerAddInfoIsNull, &leafHint);
 
 	MemoryContextSwitchTo(oldCtx);
 	MemoryContextDelete(insertCtx);
 
 	return false;
 }
+
+#ifdef RUM_INSERT_BUFFER
+/*
+ * End of the inserting statement, add buffered entries to the index.
+ */
+void
+ruminsertcleanup(Relation index, struct IndexInfo *indexInfo)
+{
+	RumPendingInserts *pending = pendingInsertsFind(RelationGetRelid(index));
+
+	if (pending != NULL)
+		pendingInsertsFlush(pending, index,
+							(RumState *) indexInfo->ii_AmCache);
+}
+
+/*
+ * Add entries buffered by the current transaction to the index before it's
+ * scanned.  Index can't be modified in parallel mode, and parallel workers
+ * can't see the buffer of the leader, while a query run by the inserting
+ * statement may see its rows.  Buffers are flushed before a parallel query
+ * starts, so such a scan is refused just in case.
+ */
+void
+rumFlushPendingInserts(Relation index)
+{
+	RumPendingInserts *pending;
+
+	if (pendingInserts == NULL)
+		return;
+
+	pending = pendingInsertsFind(RelationGetRelid(index));
+	if (pending == NULL || pending->isEmpty)
+		return;
+
+	if (IsInParallelMode())
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot scan RUM index \"%s\" with buffered inserts in parallel mode",
+						RelationGetRelationName(index)),
+				 errhint("Set rum.insert_buffer to off.")));
+
+	pendingInsertsFlush(pending, index, NULL);
+}
+
+/*
+ * Flush the buffers before a query which may run parallel workers starts.
+ * The workers don't see the buffers, and the index can't be modified once
+ * the leader enters parallel mode.  Scans may be begun by workers only, so
+ * it can't be done at scan start.
+ */
+static void
+pendingInsertsExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (pendingInserts != NULL &&
+		queryDesc->plannedstmt->parallelModeNeeded &&
+		!IsInParallelMode() &&
+		(eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
+		pendingInsertsFlushAll();
+
+	if (prevExecutorStart)
+		prevExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+}
+
+void
+rumInsertBufferInit(void)
+{
+	prevExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = pendingInsertsExecutorStart;
+}
+#endif
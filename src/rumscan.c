@@ -29,6 +29,10 @@ rumbeginscan(Relation rel, int nkeys, int norderbys)
 	/* allocate private workspace */
 	so = (RumScanOpaque) palloc(sizeof(RumScanOpaqueData));
 	so->sortstate = NULL;
+	so->topKItems = NULL;
+	so->nTopKItems = 0;
+	so->returnedItems = NULL;
+	so->nReturnedItems = 0;
 	so->keys = NULL;
 	so->nkeys = 0;
 	so->firstCall = true;
@@ -40,6 +44,25 @@ rumbeginscan(Relation rel, int nkeys, int norderbys)
 								  "Rum scan key context");
 	so->scanWithAltOrderKeys = false;
 	so->tbm = NULL;
+	so->useAltOrderTids = false;
+	so->altOrderTids = NULL;
+	so->nAltOrderTids = 0;
+	so->parallelChunks = false;
+
+	so->prefetchDistance = RumHeapPrefetchDistance;
+	so->prefetchItems = NULL;
+	if (so->prefetchDistance > 0)
+	{
+		Size		itemSize = MAXALIGN(RumSortItemSize(norderbys));
+		char	   *ptr;
+		int			i;
+
+		so->prefetchItems = (RumSortItem **)
+			palloc(sizeof(RumSortItem *) * so->prefetchDistance);
+		ptr = (char *) palloc(itemSize * so->prefetchDistance);
+		for (i = 0; i < so->prefetchDistance; i++)
+			so->prefetchItems[i] = (RumSortItem *) (ptr + i * itemSize);
+	}
 
 	initRumState(&so->rumstate, scan->indexRelation);
 
@@ -114,6 +137,7 @@ rumFillScanEntry(RumScanOpaque so, OffsetNumber attnum,
 	scanEntry->curKeyCategory = RUM_CAT_NULL_KEY;
 	scanEntry->useCurKey = false;
 	scanEntry->matchSortstate = NULL;
+	scanEntry->matchMerge = NULL;
 	scanEntry->stack = NULL;
 	scanEntry->scanWithAddInfo = false;
 	scanEntry->list = NULL;
@@ -121,6 +145,7 @@ rumFillScanEntry(RumScanOpaque so, OffsetNumber attnum,
 	scanEntry->stack = NULL;
 	scanEntry->nlist = 0;
 	scanEntry->matchSortstate = NULL;
+	scanEntry->matchMerge = NULL;
 	scanEntry->offset = InvalidOffsetNumber;
 	scanEntry->isFinished = false;
 	scanEntry->reduceResult = false;
@@ -330,6 +355,8 @@ freeScanEntries(RumScanEntry *entries, uint32 nentries)
 		if (entry->gdi)
 		{
 			freeRumBtreeStack(entry->gdi->stack);
+			if (entry->gdi->strategy)
+				FreeAccessStrategy(entry->gdi->strategy);
 			pfree(entry->gdi);
 		}
 		else
@@ -343,6 +370,8 @@ freeScanEntries(RumScanEntry *entries, uint32 nentries)
 			pfree(entry->list);
 		if (entry->matchSortstate)
 			rum_tuplesort_end(entry->matchSortstate);
+		if (entry->matchMerge)
+			rumFreeMatchMerge(entry);
 		pfree(entry);
 	}
 }
@@ -367,6 +396,15 @@ freeScanKeys(RumScanOpaque so)
 		rum_tuplesort_end(so->sortstate);
 		so->sortstate = NULL;
 	}
+
+	/* these are allocated in keyCtx */
+	so->topKItems = NULL;
+	so->nTopKItems = 0;
+	so->returnedItems = NULL;
+	so->nReturnedItems = 0;
+	so->useAltOrderTids = false;
+	so->altOrderTids = NULL;
+	so->nAltOrderTids = 0;
 }
 
 static void
@@ -774,6 +812,45 @@ rumendscan(IndexScanDesc scan)
 	pfree(so);
 }
 
+#if PG_VERSION_NUM >= 100000
+/*
+ * Parallel scan support
+ */
+Size
+#if PG_VERSION_NUM >= 180000
+rumestimateparallelscan(Relation indexRelation, int nkeys, int norderbys)
+#elif PG_VERSION_NUM >= 170000
+rumestimateparallelscan(int nkeys, int norderbys)
+#else
+rumestimateparallelscan(void)
+#endif
+{
+	return sizeof(RumParallelScanDescData);
+}
+
+void
+ruminitparallelscan(void *target)
+{
+	RumParallelScanDesc pscan = (RumParallelScanDesc) target;
+
+	SpinLockInit(&pscan->mutex);
+	pscan->chunkBlocks = RumParallelChunkSize;
+	pscan->nextChunk = 0;
+	pscan->scanClaimed = false;
+}
+
+void
+rumparallelrescan(IndexScanDesc scan)
+{
+	RumParallelScanDesc pscan = RumGetParallelScanDesc(scan);
+
+	SpinLockAcquire(&pscan->mutex);
+	pscan->nextChunk = 0;
+	pscan->scanClaimed = false;
+	SpinLockRelease(&pscan->mutex);
+}
+#endif
+
 Datum
 rummarkpos(PG_FUNCTION_ARGS)
 {
@@ -13,17 +13,24 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
+#include "access/genam.h"
 #include "access/htup_details.h"
 #include "access/reloptions.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_opclass.h"
 #include "catalog/pg_type.h"
+#include "commands/vacuum.h"
 #include "miscadmin.h"
+#include "optimizer/cost.h"
 #include "storage/indexfsm.h"
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/hsearch.h"
 #include "utils/index_selfuncs.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
@@ -39,6 +46,22 @@ PG_FUNCTION_INFO_V1(rumhandler);
 /* Kind of relation optioms for rum index */
 static relopt_kind rum_relopt_kind;
 
+/*
+ * Options of RUM indexes needed by the planner, so that it doesn't open the
+ * index for each path.  Entries are dropped on relcache invalidation.
+ */
+typedef struct RumPlannerOptions
+{
+	Oid			indexoid;		/* hash key */
+	bool		useAlternativeOrder;
+	AttrNumber	attrnAttachColumn;
+	AttrNumber	attrnAddToColumn;
+}	RumPlannerOptions;
+
+static HTAB *rumPlannerOptionsCache = NULL;
+
+static void rumPlannerOptionsInvalidate(Datum arg, Oid relid);
+
 static const struct config_enum_entry rum_array_similarity_function_opts[] =
 {
 	{ "cosine",		SMT_COSINE,		false },
@@ -62,6 +85,43 @@ _PG_init(void)
 							PGC_USERSET, 0,
 							NULL, NULL, NULL);
 
+	DefineCustomIntVariable("rum.sort_limit",
+				"Sets the number of best ordered results kept in memory by RUM scan.",
+				"If a query needs more rows, the index is scanned again. "
+				"Zero disables the limit.",
+							&RumSortLimit,
+							0, 0, INT_MAX,
+							PGC_USERSET, 0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("rum.heap_prefetch_distance",
+				"Sets the number of index items read ahead by RUM index scan to prefetch their heap blocks.",
+				"Zero disables prefetching.",
+							&RumHeapPrefetchDistance,
+							0, 0, 1024,
+							PGC_USERSET, 0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("rum.parallel_chunk_size",
+				"Sets the number of heap blocks claimed at once by a participant of parallel RUM index scan.",
+							NULL,
+							&RumParallelChunkSize,
+							RUM_PARALLEL_CHUNK_BLOCKS, 1,
+							RUM_PARALLEL_CHUNK_BLOCKS_MAX,
+							PGC_USERSET, 0,
+							NULL, NULL, NULL);
+
+#ifdef RUM_INSERT_BUFFER
+	DefineCustomBoolVariable("rum.insert_buffer",
+				"Buffers entries of rows inserted by a statement in memory.",
+				"The entries are added to the index in key order when the "
+				"buffer exceeds work_mem and at the end of statement.",
+							 &RumInsertBuffer,
+							 false,
+							 PGC_USERSET, 0,
+							 NULL, NULL, NULL);
+#endif
+
 	DefineCustomRealVariable("rum.array_similarity_threshold",
 							 "Sets the array similarity threshold.",
 							 NULL,
@@ -79,6 +139,11 @@ _PG_init(void)
 							 PGC_USERSET, 0,
 							 NULL, NULL, NULL);
 
+	CacheRegisterRelcacheCallback(rumPlannerOptionsInvalidate, (Datum) 0);
+#ifdef RUM_INSERT_BUFFER
+	rumInsertBufferInit();
+#endif
+
 	rum_relopt_kind = add_reloption_kind();
 
 	add_string_reloption(rum_relopt_kind, "attach",
@@ -102,6 +167,194 @@ _PG_init(void)
 					   , AccessExclusiveLock
 #endif
 					   );
+	add_int_reloption(rum_relopt_kind, "fillfactor",
+					  "Packs posting tree leaf pages only to this percentage",
+					  RUM_DEFAULT_FILLFACTOR, RUM_MIN_FILLFACTOR, 100
+#if PG_VERSION_NUM >= 130000
+					  , ShareUpdateExclusiveLock
+#endif
+					  );
+}
+
+static void
+rumPlannerOptionsInvalidate(Datum arg, Oid relid)
+{
+	HASH_SEQ_STATUS status;
+	RumPlannerOptions *entry;
+
+	if (rumPlannerOptionsCache == NULL)
+		return;
+
+	if (OidIsValid(relid))
+	{
+		hash_search(rumPlannerOptionsCache, &relid, HASH_REMOVE, NULL);
+		return;
+	}
+
+	hash_seq_init(&status, rumPlannerOptionsCache);
+	while ((entry = (RumPlannerOptions *) hash_seq_search(&status)) != NULL)
+		hash_search(rumPlannerOptionsCache, &entry->indexoid, HASH_REMOVE, NULL);
+}
+
+static RumPlannerOptions *
+rumGetPlannerOptions(Oid indexoid)
+{
+	RumPlannerOptions *entry;
+	RumPlannerOptions options;
+	RumOptions *rdopts;
+	Relation	index;
+	bool		found;
+
+	if (rumPlannerOptionsCache == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(RumPlannerOptions);
+		ctl.hcxt = CacheMemoryContext;
+		rumPlannerOptionsCache = hash_create("RUM planner options", 16, &ctl,
+											 HASH_ELEM | HASH_BLOBS |
+											 HASH_CONTEXT);
+	}
+
+	entry = (RumPlannerOptions *) hash_search(rumPlannerOptionsCache,
+											  &indexoid, HASH_FIND, NULL);
+	if (entry)
+		return entry;
+
+	memset(&options, 0, sizeof(options));
+	options.indexoid = indexoid;
+
+	index = index_open(indexoid, NoLock);
+	rdopts = (RumOptions *) index->rd_options;
+	if (rdopts)
+	{
+		options.useAlternativeOrder = rdopts->useAlternativeOrder;
+		if (rdopts->attachColumn > 0)
+			options.attrnAttachColumn =
+				get_attnum(indexoid, (char *) rdopts + rdopts->attachColumn);
+		if (rdopts->addToColumn > 0)
+			options.attrnAddToColumn =
+				get_attnum(indexoid, (char *) rdopts + rdopts->addToColumn);
+	}
+	index_close(index, NoLock);
+
+	entry = (RumPlannerOptions *) hash_search(rumPlannerOptionsCache,
+											  &indexoid, HASH_ENTER, &found);
+	*entry = options;
+
+	return entry;
+}
+
+/*
+ * Returns true if the ordered scan of the path returns items in posting tree
+ * order, so they are neither collected nor sorted.  As in fillMarkAddInfo(),
+ * this takes an order_by_attach index, ordering by the attached column with
+ * a directed distance operator (<=| or |=>) and a condition on the column it
+ * is added to.
+ */
+static bool
+rumPathHasNaturalOrder(IndexPath *path)
+{
+	IndexOptInfo *indexinfo = path->indexinfo;
+	RumPlannerOptions *options = NULL;
+	ListCell   *lcorderby,
+			   *lccol;
+
+	forboth(lcorderby, path->indexorderbys, lccol, path->indexorderbycols)
+	{
+		Expr	   *orderby = (Expr *) lfirst(lcorderby);
+		int			indexcol = lfirst_int(lccol);
+		int			strategy;
+
+		if (!IsA(orderby, OpExpr))
+			return false;
+
+		strategy = get_op_opfamily_strategy(((OpExpr *) orderby)->opno,
+											indexinfo->opfamily[indexcol]);
+		if (strategy != RUM_LEFT_DISTANCE && strategy != RUM_RIGHT_DISTANCE)
+			return false;
+
+		if (options == NULL)
+			options = rumGetPlannerOptions(indexinfo->indexoid);
+		if (!options->useAlternativeOrder ||
+			indexcol + 1 != options->attrnAttachColumn)
+			return false;
+	}
+
+	if (options == NULL)
+		return false;
+
+#if PG_VERSION_NUM >= 120000
+	foreach(lccol, path->indexclauses)
+	{
+		IndexClause *iclause = (IndexClause *) lfirst(lccol);
+
+		if (iclause->indexcol + 1 == options->attrnAddToColumn)
+			return true;
+	}
+#else
+	foreach(lccol, path->indexqualcols)
+	{
+		if (lfirst_int(lccol) + 1 == options->attrnAddToColumn)
+			return true;
+	}
+#endif
+
+	return false;
+}
+
+/*
+ * Cost estimate of RUM index scan.  Bitmap and unordered scans cost the same
+ * as in GIN.  But an ordered scan can't return anything until it has
+ * collected all the matching items, computed their distances and sorted
+ * them (see rumgettuple()), so all of its cost is startup cost, unless it
+ * follows the order of posting trees of order_by_attach index.  When the
+ * query LIMIT fits in rum.sort_limit, only that many best items are kept in
+ * a bounded heap instead of sorting all of them.
+ */
+static void
+rumcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
+				Cost *indexStartupCost, Cost *indexTotalCost,
+				Selectivity *indexSelectivity, double *indexCorrelation
+#if PG_VERSION_NUM >= 100000
+				, double *indexPages
+#endif
+				)
+{
+	int			norderbys = list_length(path->indexorderbys);
+	double		ntuples,
+				sortTuples;
+
+	gincostestimate(root, path, loop_count,
+					indexStartupCost, indexTotalCost,
+					indexSelectivity, indexCorrelation
+#if PG_VERSION_NUM >= 100000
+					, indexPages
+#endif
+					);
+
+	if (norderbys == 0 || rumPathHasNaturalOrder(path))
+		return;
+
+	ntuples = *indexSelectivity * path->indexinfo->rel->tuples;
+	if (ntuples < 1.0)
+		ntuples = 1.0;
+
+	/* Distance is calculated for each matching item and ORDER BY operator */
+	*indexTotalCost += ntuples * norderbys * cpu_operator_cost;
+
+	/* Full sort, or bounded heap if the LIMIT fits in rum.sort_limit */
+	sortTuples = ntuples;
+	if (RumSortLimit > 0 && root->limit_tuples > 0 &&
+		root->limit_tuples <= RumSortLimit)
+		sortTuples = Min(ntuples, 2.0 * root->limit_tuples);
+	if (sortTuples > 1.0)
+		*indexTotalCost += 2.0 * cpu_operator_cost * ntuples *
+			(log(sortTuples) / log(2.0));
+
+	*indexStartupCost = *indexTotalCost;
 }
 
 /*
@@ -127,17 +380,27 @@ rumhandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = true;
 #if PG_VERSION_NUM >= 100000
-	amroutine->amcanparallel = false;
+	amroutine->amcanparallel = true;
+#endif
+#if PG_VERSION_NUM >= 170000
+	amroutine->amcanbuildparallel = true;
+#endif
+#if PG_VERSION_NUM >= 130000
+	amroutine->amparallelvacuumoptions =
+		VACUUM_OPTION_PARALLEL_BULKDEL | VACUUM_OPTION_PARALLEL_CLEANUP;
 #endif
 	amroutine->amkeytype = InvalidOid;
 
 	amroutine->ambuild = rumbuild;
 	amroutine->ambuildempty = rumbuildempty;
 	amroutine->aminsert = ruminsert;
+#ifdef RUM_INSERT_BUFFER
+	amroutine->aminsertcleanup = ruminsertcleanup;
+#endif
 	amroutine->ambulkdelete = rumbulkdelete;
 	amroutine->amvacuumcleanup = rumvacuumcleanup;
 	amroutine->amcanreturn = NULL;
-	amroutine->amcostestimate = gincostestimate;
+	amroutine->amcostestimate = rumcostestimate;
 	amroutine->amoptions = rumoptions;
 	amroutine->amproperty = rumproperty;
 	amroutine->amvalidate = rumvalidate;
@@ -149,9 +412,9 @@ rumhandler(PG_FUNCTION_ARGS)
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
 #if PG_VERSION_NUM >= 100000
-	amroutine->amestimateparallelscan = NULL;
-	amroutine->aminitparallelscan = NULL;
-	amroutine->amparallelrescan = NULL;
+	amroutine->amestimateparallelscan = rumestimateparallelscan;
+	amroutine->aminitparallelscan = ruminitparallelscan;
+	amroutine->amparallelrescan = rumparallelrescan;
 #endif
 
 	PG_RETURN_POINTER(amroutine);
@@ -313,6 +576,10 @@ initRumState(RumState * state, Relation index)
 			}
 		}
 
+		state->leafReadItems[i] =
+			rumSelectLeafReadItems(state->useAlternativeOrder,
+								   state->addAttrs[i]);
+
 		/*
 		 * If the compare proc isn't specified in the opclass definition, look
 		 * up the index key type's default btree comparator.
@@ -893,7 +1160,8 @@ rumoptions(Datum reloptions, bool validate)
 	static const relopt_parse_elt tab[] = {
 		{"attach", RELOPT_TYPE_STRING, offsetof(RumOptions, attachColumn)},
 		{"to", RELOPT_TYPE_STRING, offsetof(RumOptions, addToColumn)},
-		{"order_by_attach", RELOPT_TYPE_BOOL, offsetof(RumOptions, useAlternativeOrder)}
+		{"order_by_attach", RELOPT_TYPE_BOOL, offsetof(RumOptions, useAlternativeOrder)},
+		{"fillfactor", RELOPT_TYPE_INT, offsetof(RumOptions, fillfactor)}
 	};
 #if PG_VERSION_NUM < 130000
 	relopt_value *options;
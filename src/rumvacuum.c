@@ -18,6 +18,10 @@
 #include "storage/indexfsm.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#if PG_VERSION_NUM >= 170000
+#include "storage/read_stream.h"
+#endif
+#include "utils/spccache.h"
 
 #include "rum.h"
 
@@ -274,13 +278,34 @@ rumVacuumPostingTreeLeaves(RumVacuumState * gvs, OffsetNumber attnum,
 	}
 	else
 	{
-		OffsetNumber i;
+		OffsetNumber i,
+					prefetchOff = FirstOffsetNumber + 1;
 		bool		isChildHasVoid = false;
+		int			distance;
+
+#if PG_VERSION_NUM >= 130000
+		distance = get_tablespace_maintenance_io_concurrency(
+											gvs->index->rd_rel->reltablespace);
+#else
+		distance = get_tablespace_io_concurrency(
+											gvs->index->rd_rel->reltablespace);
+#endif
 
 		for (i = FirstOffsetNumber; i <= RumPageGetOpaque(page)->maxoff; i++)
 		{
 			RumPostingItem *pitem = (RumPostingItem *) RumDataPageGetItem(page, i);
 
+			/* Read ahead the children vacuumed next */
+			for (; prefetchOff <= RumPageGetOpaque(page)->maxoff &&
+				 (int) prefetchOff <= (int) i + distance; prefetchOff++)
+			{
+				RumPostingItem *next = (RumPostingItem *)
+					RumDataPageGetItem(page, prefetchOff);
+
+				PrefetchBuffer(gvs->index, MAIN_FORKNUM,
+							   RumPostingItemGetBlockNumber(next));
+			}
+
 			if (rumVacuumPostingTreeLeaves(gvs, attnum,
 										   RumPostingItemGetBlockNumber(pitem),
 										   false, NULL))
@@ -727,6 +752,15 @@ rumbulkdelete(IndexVacuumInfo *info,
 
 		blkno = RumPageGetOpaque(page)->rightlink;
 
+		/*
+		 * Read the next entry page and the posting tree roots ahead while
+		 * the posting trees are vacuumed.
+		 */
+		if (blkno != InvalidBlockNumber)
+			PrefetchBuffer(index, MAIN_FORKNUM, blkno);
+		for (i = 0; i < nRoot; i++)
+			PrefetchBuffer(index, MAIN_FORKNUM, rootOfPostingTree[i]);
+
 		if (resPage)
 		{
 			GenericXLogState *state;
@@ -770,6 +804,28 @@ rumbulkdelete(IndexVacuumInfo *info,
 	return gvs.result;
 }
 
+#if PG_VERSION_NUM >= 170000
+typedef struct
+{
+	BlockNumber next;
+	BlockNumber npages;
+}	RumVacuumStreamState;
+
+/*
+ * Read stream callback of rumvacuumcleanup(): all the blocks in order.
+ */
+static BlockNumber
+rumVacuumStreamNextBlock(ReadStream *stream, void *callback_private_data,
+						 void *per_buffer_data)
+{
+	RumVacuumStreamState *p = (RumVacuumStreamState *) callback_private_data;
+
+	if (p->next >= p->npages)
+		return InvalidBlockNumber;
+	return p->next++;
+}
+#endif
+
 IndexBulkDeleteResult *
 rumvacuumcleanup(IndexVacuumInfo *info, IndexBulkDeleteResult *stats)
 {
@@ -779,6 +835,10 @@ rumvacuumcleanup(IndexVacuumInfo *info, IndexBulkDeleteResult *stats)
 				blkno;
 	BlockNumber totFreePages;
 	GinStatsData idxStat;
+#if PG_VERSION_NUM >= 170000
+	RumVacuumStreamState streamState;
+	ReadStream *stream;
+#endif
 
 	/*
 	 * In an autovacuum analyze, we want to clean up pending insertions.
@@ -817,6 +877,19 @@ rumvacuumcleanup(IndexVacuumInfo *info, IndexBulkDeleteResult *stats)
 
 	totFreePages = 0;
 
+#if PG_VERSION_NUM >= 170000
+	streamState.next = RUM_ROOT_BLKNO;
+	streamState.npages = npages;
+	stream = read_stream_begin_relation(READ_STREAM_MAINTENANCE |
+										READ_STREAM_FULL,
+										info->strategy,
+										index,
+										MAIN_FORKNUM,
+										rumVacuumStreamNextBlock,
+										&streamState,
+										0);
+#endif
+
 	for (blkno = RUM_ROOT_BLKNO; blkno < npages; blkno++)
 	{
 		Buffer		buffer;
@@ -828,8 +901,13 @@ rumvacuumcleanup(IndexVacuumInfo *info, IndexBulkDeleteResult *stats)
 		vacuum_delay_point();
 #endif
 
+#if PG_VERSION_NUM >= 170000
+		buffer = read_stream_next_buffer(stream, NULL);
+		Assert(BufferGetBlockNumber(buffer) == blkno);
+#else
 		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno,
 									RBM_NORMAL, info->strategy);
+#endif
 		LockBuffer(buffer, RUM_SHARE);
 		page = (Page) BufferGetPage(buffer);
 
@@ -854,6 +932,11 @@ rumvacuumcleanup(IndexVacuumInfo *info, IndexBulkDeleteResult *stats)
 		UnlockReleaseBuffer(buffer);
 	}
 
+#if PG_VERSION_NUM >= 170000
+	Assert(read_stream_next_buffer(stream, NULL) == InvalidBuffer);
+	read_stream_end(stream);
+#endif
+
 	/* Update the metapage with accurate page and entry counts */
 	idxStat.nTotalPages = npages;
 	rumUpdateStats(info->index, &idxStat, false);